@@ -1,6 +1,9 @@
 """
-Decodes the array of 10 concatenated 16-bit RMS values into two arrays (one for each ADC input)
+Decodes the array of 10 concatenated 16-bit RMS values into two arrays (one for each ADC input),
+followed (if present) by the Goertzel magnitudes: 4 target frequencies per input.
 """
+N_RMS = 10
+N_GOERTZEL = 4
 print("Press ctrl+C to exit")
 try:
     while True:
@@ -9,6 +12,12 @@ try:
             label = "ADC1: " if i<5 else "ADC2: "
             label_print = label if i==0 or i==5 else ""
             print(f"{label_print}{int(hex_vals[2+4*i:2+4*i+2], 16)}", end=", " if i!=4 and i!=9 else "\n")
+        n_vals = (len(hex_vals) - 2) // 4
+        for i in range(N_RMS, n_vals):
+            j = i - N_RMS
+            label = ("ADC1 spectrum: " if j < N_GOERTZEL else "ADC2 spectrum: ") if j % N_GOERTZEL == 0 else ""
+            val = int(hex_vals[2+4*i:2+4*i+2], 16) | int(hex_vals[2+4*i+2:2+4*i+4], 16) << 8
+            print(f"{label}{val}", end="\n" if j % N_GOERTZEL == N_GOERTZEL - 1 or i == n_vals - 1 else ", ")
         print("",end="\n")
 except KeyboardInterrupt:
-    pass
\ No newline at end of file
+    pass
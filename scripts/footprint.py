@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+Per-module RAM/flash footprint from the linker map, checked against budgets.
+
+Every input section of the final link is charged to a module by the object
+file it came from. Sections placed in RAM count as RAM; sections in flash, and
+the load image of initialized RAM data, count as flash. Invoked after linking
+from CMakeLists.txt with the CONFIG_FOOTPRINT_* budgets; exits non-zero when
+one is exceeded so the build fails.
+
+    python3 scripts/footprint.py build/zephyr/zephyr.map --budget rms:72:12
+"""
+import argparse
+import json
+import re
+import sys
+
+# Application sources per module
+MODULE_FILES = {
+    "acquisition": ["main.c", "adc.c", "pipeline.c", "filter.c", "goertzel.c", "replay.c"],
+    "rms": ["rms.c", "imath.c", "history.c", "event.c"],
+    "bt": ["bt.c", "cmd.c", "link.c"],
+    "setup": ["setup.c", "input.c", "state.c", "battery.c", "mem.c"],
+    "app other": ["wave.c", "lut.c", "lut_tables.c", "bench.c"],
+}
+
+# Libraries of the Bluetooth host and controller
+BT_STACK = re.compile(r"bluetooth|softdevice_controller|mpsl|libbt", re.IGNORECASE)
+
+# Output sections that are not loaded on the device
+NOT_LOADED = re.compile(r"^(\.debug|\.comment|\.ARM\.attributes|\.stab|\.note|\.symtab|\.strtab|\.shstrtab|/DISCARD/)")
+
+OUTPUT_SECTION = re.compile(r"^(\S+)?\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?\s*$")
+INPUT_SECTION = re.compile(r"^ (\S+)?\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+
+
+def module_of(obj):
+    member = re.search(r"\(([^)]+)\.obj\)$", obj) or re.search(r"([^/\\]+)\.obj$", obj)
+    if "libapp.a" in obj or "app.dir" in obj:
+        name = member.group(1) if member else obj
+        for module, files in MODULE_FILES.items():
+            if name in files:
+                return module
+        return "app other"
+    if BT_STACK.search(obj):
+        return "bt stack"
+    return "kernel + libs"
+
+
+def parse_map(path, ram_base):
+    usage = {}
+    out_name = None  # current output section
+    in_ram = loaded = False
+    pending = None  # section name on a line of its own
+    started = False
+
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not started:
+                started = line.startswith("Linker script and memory map")
+                continue
+
+            # output section header, possibly with the name wrapped onto its own line
+            if line and not line[0].isspace():
+                m = OUTPUT_SECTION.match(line)
+                if m:
+                    out_name = m.group(1)
+                    vma = int(m.group(2), 16)
+                    in_ram = vma >= ram_base
+                    loaded = not in_ram or m.group(4) is not None
+                else:
+                    out_name = line.split()[0]
+                    pending = "output"
+                continue
+            if pending == "output":
+                m = OUTPUT_SECTION.match(line)
+                pending = None
+                if m:
+                    vma = int(m.group(2), 16)
+                    in_ram = vma >= ram_base
+                    loaded = not in_ram or m.group(4) is not None
+                continue
+
+            if out_name is None or NOT_LOADED.match(out_name):
+                continue
+
+            m = INPUT_SECTION.match(line)
+            if m is None:
+                # a long input section name wraps its address, size and file onto the next line
+                s = line.strip()
+                pending = s if line.startswith(" ") and s and not s.startswith(("0x", "*")) and " " not in s else None
+                continue
+            name = m.group(1) or pending
+            pending = None
+            if name is None or name.startswith("*"):
+                continue  # fill and patterns
+            size = int(m.group(3), 16)
+            if size == 0:
+                continue
+
+            entry = usage.setdefault(module_of(m.group(4)), {"flash": 0, "ram": 0})
+            if in_ram:
+                entry["ram"] += size
+            if loaded:
+                entry["flash"] += size
+    return usage
+
+
+def parse_budget(text):
+    module, ram_kb, flash_kb = text.rsplit(":", 2)
+    return module.replace("_", " "), int(ram_kb), int(flash_kb)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("map_file")
+    parser.add_argument("--ram-base", type=lambda x: int(x, 0), default=0x20000000)
+    parser.add_argument("--budget", action="append", default=[], type=parse_budget,
+                        help="module:ram_kb:flash_kb, 0 = no limit")
+    parser.add_argument("--json", help="also write the report here, for tracking over time")
+    args = parser.parse_args()
+
+    usage = parse_map(args.map_file, args.ram_base)
+    budgets = {module: (ram_kb, flash_kb) for module, ram_kb, flash_kb in args.budget}
+
+    print(f"{'module':<16}{'flash':>10}{'RAM':>10}   budget (flash/RAM)")
+    failures = []
+    for module in sorted(usage, key=lambda m: -usage[m]["ram"]):
+        flash, ram = usage[module]["flash"], usage[module]["ram"]
+        ram_kb, flash_kb = budgets.get(module, (0, 0))
+        limits = f"{flash_kb or '-'} / {ram_kb or '-'} KB" if module in budgets else ""
+        print(f"{module:<16}{flash / 1024:>8.1f}KB{ram / 1024:>8.1f}KB   {limits}")
+        if ram_kb and ram > ram_kb * 1024:
+            failures.append(f"{module} RAM {ram / 1024:.1f} KB exceeds its budget of {ram_kb} KB")
+        if flash_kb and flash > flash_kb * 1024:
+            failures.append(f"{module} flash {flash / 1024:.1f} KB exceeds its budget of {flash_kb} KB")
+    total_flash = sum(u["flash"] for u in usage.values())
+    total_ram = sum(u["ram"] for u in usage.values())
+    print(f"{'total':<16}{total_flash / 1024:>8.1f}KB{total_ram / 1024:>8.1f}KB")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"modules": usage, "budgets_kb": budgets}, f, indent=2, sort_keys=True)
+
+    for failure in failures:
+        print(f"footprint: {failure}", file=sys.stderr)
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
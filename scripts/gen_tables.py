@@ -0,0 +1,91 @@
+"""
+Generates the integer lookup tables (sine, gamma-corrected brightness, battery discharge curve)
+used by tools/lut.c. Invoked from CMakeLists.txt with the sizes configured in Kconfig.
+"""
+import argparse
+import math
+import os
+
+FULL_SCALE = 10000  # 0.01 % units, see LUT_FULL_SCALE
+
+# Li-ion open-circuit voltage (mV) vs. state of charge (%), ordered by voltage
+LIION_CURVE = [
+    (3270, 0), (3610, 5), (3690, 10), (3710, 15), (3730, 20), (3750, 25), (3770, 30),
+    (3790, 35), (3800, 40), (3820, 45), (3840, 50), (3850, 55), (3870, 60), (3910, 65),
+    (3950, 70), (3980, 75), (4020, 80), (4080, 85), (4110, 90), (4150, 95), (4200, 100),
+]
+
+
+def sine_table(steps):
+    return [round(FULL_SCALE / 2 * math.sin(2 * math.pi * i / steps) + FULL_SCALE / 2) for i in range(steps)]
+
+
+def gamma_table(steps, gamma):
+    return [round(FULL_SCALE * (i / (steps - 1)) ** gamma) for i in range(steps)]
+
+
+def soc(batt_mv):
+    if batt_mv <= LIION_CURVE[0][0]:
+        return LIION_CURVE[0][1]
+    for (v0, p0), (v1, p1) in zip(LIION_CURVE, LIION_CURVE[1:]):
+        if batt_mv <= v1:
+            return round(p0 + (p1 - p0) * (batt_mv - v0) / (v1 - v0))
+    return LIION_CURVE[-1][1]
+
+
+def batt_table(steps, mv_min, mv_max, divider_ppm):
+    # indexed by the voltage seen at the ADC pin, i.e. after the external divider
+    adc_min = mv_min * divider_ppm // 1000000
+    adc_max = mv_max * divider_ppm // 1000000
+    step = -(-(adc_max - adc_min) // (steps - 1))
+    table = [soc((adc_min + i * step) * 1000000 / divider_ppm) for i in range(steps)]
+    return adc_min, step, table
+
+
+def c_array(ctype, name, values, per_line=10):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    return f"const {ctype} {name}[{len(values)}] = {{\n" + "\n".join(lines) + "\n};\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--out-dir", required=True)
+    parser.add_argument("--sine-steps", type=int, required=True)
+    parser.add_argument("--gamma-steps", type=int, required=True)
+    parser.add_argument("--gamma-x10", type=int, required=True)
+    parser.add_argument("--batt-steps", type=int, required=True)
+    parser.add_argument("--batt-mv-min", type=int, required=True)
+    parser.add_argument("--batt-mv-max", type=int, required=True)
+    parser.add_argument("--batt-divider-ppm", type=int, required=True)
+    args = parser.parse_args()
+
+    sine = sine_table(args.sine_steps)
+    gamma = gamma_table(args.gamma_steps, args.gamma_x10 / 10)
+    batt_adc_min, batt_step, batt = batt_table(args.batt_steps, args.batt_mv_min,
+                                               args.batt_mv_max, args.batt_divider_ppm)
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    with open(os.path.join(args.out_dir, "lut_tables.h"), "w") as f:
+        f.write("/* Generated by scripts/gen_tables.py, do not edit */\n")
+        f.write("#ifndef LUT_TABLES_H\n#define LUT_TABLES_H\n\n#include <stdint.h>\n\n")
+        f.write(f"#define LUT_FULL_SCALE {FULL_SCALE}\n")
+        f.write(f"#define LUT_SINE_STEPS {len(sine)}\n")
+        f.write(f"#define LUT_GAMMA_STEPS {len(gamma)}\n")
+        f.write(f"#define LUT_BATT_STEPS {len(batt)}\n")
+        f.write(f"#define LUT_BATT_ADC_MV_MIN {batt_adc_min}\n")
+        f.write(f"#define LUT_BATT_ADC_MV_STEP {batt_step}\n\n")
+        f.write("extern const uint16_t lut_sine[LUT_SINE_STEPS];\n")
+        f.write("extern const uint16_t lut_gamma_table[LUT_GAMMA_STEPS];\n")
+        f.write("extern const uint8_t lut_batt_table[LUT_BATT_STEPS];\n\n#endif\n")
+    with open(os.path.join(args.out_dir, "lut_tables.c"), "w") as f:
+        f.write("/* Generated by scripts/gen_tables.py, do not edit */\n")
+        f.write('#include "lut_tables.h"\n\n')
+        f.write(c_array("uint16_t", "lut_sine", sine) + "\n")
+        f.write(c_array("uint16_t", "lut_gamma_table", gamma) + "\n")
+        f.write(c_array("uint8_t", "lut_batt_table", batt))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+"""
+Converts a CSV recording into the replay sample file read by CONFIG_REPLAY.
+
+Each CSV row is one frame; the selected columns hold raw ADC counts for
+input 1, 2, ... in zephyr,user io-channels order, one column per input.
+Output frames are little-endian int16.
+
+    python3 scripts/replay_convert.py field.csv replay.bin --columns 1,2
+"""
+import argparse
+import csv
+import struct
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("csv_file")
+    parser.add_argument("out_file")
+    parser.add_argument("--columns", default="0,1", help="CSV columns, in input order")
+    parser.add_argument("--skip", type=int, default=0, help="header rows to skip")
+    args = parser.parse_args()
+
+    cols = [int(c) for c in args.columns.split(",")]
+    frame = struct.Struct("<" + "h" * len(cols))
+    n = 0
+    with open(args.csv_file, newline="") as f_in, open(args.out_file, "wb") as f_out:
+        rows = csv.reader(f_in)
+        for _ in range(args.skip):
+            next(rows)
+        for row in rows:
+            vals = [max(-32768, min(32767, int(float(row[c])))) for c in cols]
+            f_out.write(frame.pack(*vals))
+            n += 1
+    print(f"{n} frames of {len(cols)} inputs -> {args.out_file}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""
+Scripted central for measuring data notification throughput.
+
+Connects to the device, subscribes to the data characteristic, streams at the
+requested period for a fixed time and prints what arrived next to the
+device's own counters (CMD_GET_LINK_STATS). Requires bleak, a BLE adapter
+on the host and the DK running the application.
+
+MTU and PHY are whatever the central and the device negotiate; there is no
+sweep over them, and no simulated (BabbleSim) central or test-runner entry,
+so runs are manual.
+
+    python3 scripts/throughput.py --period 20 --seconds 30
+"""
+import argparse
+import asyncio
+import struct
+import time
+
+from bleak import BleakClient, BleakScanner
+
+DATA_UUID = "8fcc2161-4abd-0000-090e-8e22d2fc7eb9"
+MESSAGE_UUID = "8fcc2162-4abd-0000-090e-8e22d2fc7eb9"
+
+CMD_STREAM_START = 0x01
+CMD_STREAM_STOP = 0x02
+CMD_GET_LINK_STATS = 0x08
+CMD_RSP_FLAG = 0x80
+
+
+async def run(args):
+    device = await BleakScanner.find_device_by_name(args.name, timeout=10.0)
+    if device is None:
+        raise SystemExit(f"{args.name} not found")
+
+    received = []
+    responses = asyncio.Queue()
+
+    def on_data(_, data):
+        received.append((time.monotonic(), len(data)))
+
+    def on_message(_, data):
+        responses.put_nowait(bytes(data))
+
+    async def command(client, payload):
+        await client.write_gatt_char(MESSAGE_UUID, bytes(payload), response=False)
+        rsp = await asyncio.wait_for(responses.get(), 2.0)
+        if rsp[0] != payload[0] | CMD_RSP_FLAG or rsp[1] != 0:
+            raise SystemExit(f"command 0x{payload[0]:02x} failed: {rsp.hex()}")
+        return rsp[2:]
+
+    async with BleakClient(device) as client:
+        await client.start_notify(MESSAGE_UUID, on_message)
+        await client.start_notify(DATA_UUID, on_data)
+
+        await command(client, [CMD_GET_LINK_STATS, 1])  # reset the device counters
+        await command(client, [CMD_STREAM_START, *struct.pack("<H", args.period)])
+        await asyncio.sleep(args.seconds)
+        await command(client, [CMD_STREAM_STOP])
+        await asyncio.sleep(0.5)  # let the last notifications arrive
+        stats = await command(client, [CMD_GET_LINK_STATS, 0])
+
+    # the device truncates the response to the MTU; fields cut off read as 0
+    if len(stats) < 26:
+        print(f"note: link stats truncated to {len(stats)} of 26 bytes by the MTU")
+    mtu, elapsed, nbytes, queued, sent, failed, lat_avg, lat_max = struct.unpack("<HIIIIIHH", stats.ljust(26, b"\0"))
+    rx_bytes = sum(n for _, n in received)
+    span = received[-1][0] - received[0][0] if len(received) > 1 else 0.0
+    expected = int(args.seconds * 1000 / args.period)
+
+    print(f"MTU {mtu}, period {args.period} ms, {args.seconds} s")
+    print(f"central:  {len(received)} notifications, {rx_bytes} B, "
+          f"{rx_bytes / span if span else 0:.0f} B/s, expected ~{expected}")
+    print(f"device:   {queued} queued, {sent} sent, {failed} refused, {nbytes} B in {elapsed} ms, "
+          f"latency avg {lat_avg} ms / max {lat_max} ms")
+    print(f"loss:     {max(queued - len(received), 0)} in flight/lost, {failed} refused by the host")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--name", default="MojoFinal")
+    parser.add_argument("--period", type=int, default=20, help="stream period (ms)")
+    parser.add_argument("--seconds", type=float, default=10.0)
+    asyncio.run(run(parser.parse_args()))
@@ -5,31 +5,24 @@
 #include <zephyr/drivers/pwm.h>
 // #include <zephyr/drivers/usb_c/usbc_vbus.h>
 #include <stdlib.h>
-#include <nrfx_power.h>
 
 #include "../tools/macros.h"
 #include "../tools/setup.h"
 #include "../tools/adc.h"
 #include "../tools/bt.h"
 #include "../tools/rms.h"
+#include "../tools/wave.h"
+#include "../tools/lut.h"
+#include "../tools/battery.h"
+#include "../tools/event.h"
+#include "../tools/pipeline.h"
+#include "../tools/state.h"
+#include "../tools/source.h"
+#include "../tools/replay.h"
 
 /* Logger */
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
-/* States */
-int state = STATE_DEFAULT;
-
-/* Voltages */
-int8_t vq1[N_VOLTAGE] = {0}; // FIFO: indexed via vble[(i1+i) % N_VOLTAGE]
-int16_t vq2[N_VOLTAGE] = {0};
-uint16_t vble[N_BLE] = {0};
-int i1_1 = 0;
-int i1_2 = 0;
-float sqsum[N_BLE] = {0};
-
-/* Miscellaneous */
-int err;
-
 /* ADC macros */
 #define ADC_DT_SPEC_GET_BY_ALIAS(node_id)                   \
 	{                                                       \
@@ -41,9 +34,13 @@ int err;
 #define DT_SPEC_AND_COMMA(node_id, prop, idx) \
 	ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
 
-/* PWM */
-const struct pwm_dt_spec pwm1 = PWM_DT_SPEC_GET(DT_ALIAS(pwm_1));
-const struct pwm_dt_spec pwm2 = PWM_DT_SPEC_GET(DT_ALIAS(pwm_2));
+#define PWM_SPEC_AND_COMMA(node_id, prop, idx) \
+	PWM_DT_SPEC_GET_BY_IDX(node_id, idx),
+
+/* PWM (one LED per input) */
+const struct pwm_dt_spec pwm_outputs[] = {
+	DT_FOREACH_PROP_ELEM(ZEPHYR_USER, pwms, PWM_SPEC_AND_COMMA)
+};
 
 /* LEDs */
 const struct gpio_dt_spec led1 = GPIO_DT_SPEC_GET(DT_ALIAS(led_1), gpios);
@@ -54,60 +51,17 @@ const struct gpio_dt_spec led3 = GPIO_DT_SPEC_GET(DT_ALIAS(led_3), gpios);
 const struct gpio_dt_spec btn_save = GPIO_DT_SPEC_GET(DT_ALIAS(btnsave), gpios);
 const struct gpio_dt_spec btn_bt = GPIO_DT_SPEC_GET(DT_ALIAS(btnbt), gpios);
 
-/* ADCs */
-const struct adc_dt_spec adc1 = ADC_DT_SPEC_GET_BY_ALIAS(adc_1);
-const struct adc_dt_spec adc2 = ADC_DT_SPEC_GET_BY_ALIAS(adc_2);
+/* ADCs (signal inputs from zephyr,user; battery by alias) */
+const struct adc_dt_spec adc_inputs[] = {
+	DT_FOREACH_PROP_ELEM(ZEPHYR_USER, io_channels, DT_SPEC_AND_COMMA)
+};
 const struct adc_dt_spec adc_bat = ADC_DT_SPEC_GET_BY_ALIAS(adc_3);
 
-/* VBUS */
-void toggle_vbus_led(struct k_timer *vbus_led_timer);
-void toggle_vbus_led(struct k_timer *vbus_led_timer)
-{
-	err = gpio_pin_toggle_dt(&led3);
-	if (err)
-		LOG_ERR("Error toggling VBUS LED.");
-}
-void set_vbus_led_off(struct k_timer *vbus_led_timer);
-void set_vbus_led_off(struct k_timer *vbus_led_timer)
-{
-	err = gpio_pin_set_dt(&led3, 0);
-	if (err)
-		LOG_ERR("Error turning off VBUS LED.");
-}
-K_TIMER_DEFINE(vbus_led_timer, toggle_vbus_led, set_vbus_led_off);
-
-void check_vbus(struct k_timer *vbus_timer);
-void check_vbus(struct k_timer *vbus_timer) {
-	bool usbregstatus = nrf_power_usbregstatus_vbusdet_get(NRF_POWER);
-	if (usbregstatus) {
-		LOG_ERR("VBUS voltage detected. Device cannot be operated while charging.");
-		if(state==STATE_DEFAULT) {
-			LOG_DBG("VBUS LED timer started.");
-			k_timer_start(&vbus_led_timer, K_MSEC(T_VBUS_LED), K_MSEC(T_VBUS_LED));
-		}
-		state = STATE_VBUS_DETECTED;
-
-		err = gpio_pin_set_dt(&led1, 0);
-		if (err) LOG_ERR("Error turning off LED 1.");
-		err = gpio_pin_set_dt(&led2, 0);
-		if (err) LOG_ERR("Error turning off LED 1.");
-	}
-	else {
-		LOG_DBG("VBUS voltage checked and not detected.");
-		k_timer_stop(&vbus_led_timer);
-		state = STATE_DEFAULT;
-	}
-}
-K_TIMER_DEFINE(vbus_timer, check_vbus, NULL);
-
-/* Battery Level */
-int batt_counter = 0;
-
 /* BLE */
-extern struct bt_conn *current_conn;
 struct bt_conn_cb bluetooth_callbacks = {
 	.connected = on_connected,
 	.disconnected = on_disconnected,
+	.le_param_updated = on_le_param_updated,
 };
 
 struct bt_remote_srv_cb remote_service_callbacks = {
@@ -115,62 +69,104 @@ struct bt_remote_srv_cb remote_service_callbacks = {
 	.data_rx = on_data_rx,
 };
 
-double vpp_to_ratio(int vpp, int vpp_min, int vpp_max);
-double vpp_to_ratio(int vpp, int vpp_min, int vpp_max)
+/* Frame clock; expirations the loop did not wait for are frames it missed */
+K_TIMER_DEFINE(frame_timer, NULL, NULL);
+
+/* Signal inputs from the SAADC, one frame per frame-timer tick */
+static int adc_read_frame(int16_t frame[N_INPUT])
 {
-	vpp = vpp < vpp_min ? vpp_min : vpp;
-	vpp = vpp > vpp_max ? vpp_max : vpp;
-	float slope = 1.0 / (vpp_max - vpp_min);
-	LOG_DBG("VPP=%d\tVmin=%d\tVmax=%d\tRatio=%f", vpp, vpp_min, vpp_max, slope * (vpp - vpp_min));
-	return slope * (vpp - vpp_min);
+	for (int ch = 0; ch < N_INPUT; ch++) {
+		int ret = read_adc_raw(&adc_inputs[ch], &frame[ch]);
+		if (ret) return ret;
+	}
+	return 0;
 }
 
-static double pwm_frac;
-void modulate_led_brightness(struct adc_dt_spec adc, struct pwm_dt_spec pwm, int led)
+static const struct frame_source adc_source = {
+	.name = "SAADC",
+	.read = adc_read_frame,
+	.paced = true,
+};
+
+/* Acquisition of one frame (every input, in scan order); blocks of frames are processed by the pipeline threads */
+void acquire_frame(const struct frame_source *source)
 {
-	int mV = read_adc(adc);
-	if (state == STATE_DEFAULT){
-		add_v(led, mV);
-		int vpp_min = led == 1 ? VPP_MIN1 : VPP_MIN2;
-		int vpp_max = led == 1 ? VPP_MAX1 : VPP_MAX2;
-		int vble_idx = led == 1 ? T_DATA_S - 1 : (T_DATA_S * N_INPUT) - 1;
-		int vpp = vble[vble_idx] * sqrt(2);
-		pwm_frac = vpp_to_ratio(vpp, vpp_min, vpp_max);
-		uint32_t pulsewidth = pwm.period * pwm_frac;
-		LOG_DBG("LED%d\tpw=%d\t=%d*%f\tvrms/vmax=%d/%d", led, pulsewidth, pwm.period, pwm_frac, vble[vble_idx], vpp_max);
-		err = pwm_set_pulse_dt(&pwm, pulsewidth);
-		if(err) LOG_ERR("Error updating duty cycle of PWM channel %d", pwm.channel);
-	}
-	else {
-		nop
+	int16_t frame[N_INPUT];
+
+	int ret = source->read(frame);
+	if (ret == -ENODATA) {
+		pipeline_drain();
+		source->finish();
+		return;
 	}
+	if (ret) return; // inputs stay in step: drop the whole frame
+	pipeline_push(frame);
 }
 
 void main(void)
 {
-	check_devices_ready(led1, pwm1, adc1, adc2, adc_bat);
-	configure_pins(led1, led2, led3, btn_save, btn_bt, adc1, adc2, adc_bat);
+	int err;
+
+	int32_t scales[N_INPUT];
+
+	check_devices_ready(led1, pwm_outputs, adc_inputs, N_INPUT);
+	configure_pins(led1, led2, led3, btn_save, btn_bt);
+	err = 0;
+	for (int ch = 0; ch < N_INPUT; ch++)
+		err += configure_adc(&adc_inputs[ch]);
+	err += configure_adc(&adc_bat);
+	if (err) LOG_ERR("Error configuring ADC channels.");
 	setup_callbacks(btn_save, btn_bt);
+	for (int ch = 0; ch < N_INPUT; ch++)
+		scales[ch] = adc_scale_q16(&adc_inputs[ch]);
+	err = pipeline_init(pwm_outputs, scales);
+	if (err) LOG_ERR("Error configuring the processing pipeline (err = %d)", err);
+	err = 0;
+	for (int ch = 0; ch < N_INPUT; ch++) {
+		int32_t stored_q16 = scales[ch] << input_raw_shift(ch);
+
+		rms_set_calibration(ch + 1, stored_q16, 0);
+		err += event_set_trigger(ch + 1, EVENT_TRIG_VPP_RANGE, input_vpp_min_mv(ch),
+					 input_vpp_max_mv(ch), stored_q16);
+	}
+	if (err) LOG_ERR("Error configuring event triggers.");
 	err = bluetooth_init(&bluetooth_callbacks, &remote_service_callbacks);
 	if (err) LOG_ERR("BT init failed (err = %d)", err);
-	k_timer_start(&vbus_timer, K_MSEC(T_VBUS), K_MSEC(T_VBUS));
+	if (IS_ENABLED(CONFIG_WAVE)) {
+		err = wave_init();
+		if (!err) err = wave_play(WAVE_SINE);
+		if (err) LOG_ERR("Waveform engine failed (err = %d)", err);
+	}
+	err = battery_init(&adc_bat);
+	if (err) LOG_ERR("Battery monitor init failed (err = %d)", err);
+	err = state_init(&led3, pwm_outputs);
+	if (err) LOG_ERR("State machine init failed (err = %d)", err);
+	const struct frame_source *source = IS_ENABLED(CONFIG_REPLAY) ? replay_source_get() : &adc_source;
+	err = source->open ? source->open() : 0;
+	if (err) LOG_ERR("Frame source %s unavailable (err = %d)", source->name, err);
+
+	// a paced source runs off the frame timer, any other as fast as the pipeline takes frames
+	if (source->paced)
+		k_timer_start(&frame_timer, K_TICKS(FRAME_TICKS), K_TICKS(FRAME_TICKS));
 	while (1)
 	{
-		k_usleep(T_ADC_READ_US);
-		if (state == STATE_DEFAULT)
+		// nothing to sample while charging: sleep until acquisition resumes
+		if (!state_is_active()) {
+			k_timer_stop(&frame_timer);
+			state_wait_active();
+			if (source->paced)
+				k_timer_start(&frame_timer, K_TICKS(FRAME_TICKS), K_TICKS(FRAME_TICKS));
+		}
+		if (source->paced) {
+			uint32_t ticks = k_timer_status_sync(&frame_timer);
+			if (ticks > 1 && state_is_active())
+				pipeline_count_missed(ticks - 1);
+		}
+		if (state_is_active())
 		{
-			/* LED Brightness Modulation */
-			modulate_led_brightness(adc1, pwm1, 1);
-			modulate_led_brightness(adc2, pwm2, 2);
-
-			/* Battery Level */
-			batt_counter++;
-			if(batt_counter == T_BAT_CHECK) {
-				batt_counter = 0;
-				int mV = read_adc(adc_bat);
-				bluetooth_set_battery_level(mV, NOMINAL_BATT_MV);
-			}
-			
+			/* Acquisition (LED brightness follows in the pipeline) */
+			acquire_frame(source);
+			battery_poll();
 		}
 	}
 }
\ No newline at end of file
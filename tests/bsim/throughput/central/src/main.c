@@ -0,0 +1,492 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include "bs_types.h"
+#include "bs_tracing.h"
+#include "bstests.h"
+#include "bt.h"
+#include "cmd.h"
+#include "macros.h"
+
+/*
+ * Scripted central for the throughput test, standing in for the phone (and
+ * scripts/throughput.py). It connects to the peripheral, takes the ATT MTU
+ * this build was configured for (mtu_*.conf), and for each PHY streams data
+ * notifications for a while and checks them against the peripheral's own
+ * link stats, then runs the commands whose responses depend on the MTU.
+ */
+
+extern enum bst_result_t bst_result;
+
+#define WAIT_TIME_S 60
+#define RSP_TIMEOUT K_SECONDS(5)
+#define STREAM_PERIOD_MS 20
+#define STREAM_TIME_MS 2000
+#define DATA_LEN ((N_BLE + N_SPECTRUM) * sizeof(uint16_t)) // as in bt.c
+#define PEER_NAME "MojoFinal"                               // CONFIG_BT_DEVICE_NAME of the peripheral
+
+#define FAIL(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Failed;                     \
+        bs_trace_error_time_line(__VA_ARGS__);   \
+    } while (0)
+
+#define PASS(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Passed;                     \
+        bs_trace_info_time(1, __VA_ARGS__);      \
+    } while (0)
+
+static struct bt_conn *conn;
+static uint16_t mtu;
+static K_SEM_DEFINE(connected, 0, 1);
+static K_SEM_DEFINE(disconnected, 0, 1);
+static K_SEM_DEFINE(mtu_done, 0, 1);
+static K_SEM_DEFINE(discovered, 0, 1);
+static K_SEM_DEFINE(phy_done, 0, 1);
+static K_SEM_DEFINE(rsp_ready, 0, 1);
+
+/* Data notifications since the last reset; written in the BT RX thread */
+struct rx_stats
+{
+    uint32_t count;
+    uint32_t bytes;
+    uint32_t bad_len;
+    uint32_t stale; // same snapshot as the one before
+    uint16_t last_rms;
+};
+
+static struct rx_stats rx;
+static uint8_t rsp[CMD_RSP_MAX];
+static uint16_t rsp_len;
+static uint32_t oversized; // message notifications longer than MTU - 3
+
+/* Scanning and connection */
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad);
+
+static bool name_matches(struct bt_data *data, void *user_data)
+{
+    bool *found = user_data;
+
+    if (data->type == BT_DATA_NAME_COMPLETE)
+    {
+        *found = data->data_len == strlen(PEER_NAME) &&
+                 memcmp(data->data, PEER_NAME, data->data_len) == 0;
+        return false;
+    }
+    return true;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
+{
+    bool found = false;
+
+    if (conn || type != BT_GAP_ADV_TYPE_ADV_IND)
+        return;
+
+    bt_data_parse(ad, name_matches, &found);
+    if (!found)
+        return;
+
+    int err = bt_le_scan_stop();
+    if (err)
+    {
+        FAIL("Could not stop scanning (err %d)\n", err);
+        return;
+    }
+
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, BT_LE_CONN_PARAM_DEFAULT, &conn);
+    if (err)
+        FAIL("Could not connect (err %d)\n", err);
+}
+
+static void central_connected(struct bt_conn *c, uint8_t err)
+{
+    if (err)
+    {
+        FAIL("Connection failed (err 0x%02x)\n", err);
+        return;
+    }
+    k_sem_give(&connected);
+}
+
+static void central_disconnected(struct bt_conn *c, uint8_t reason)
+{
+    bt_conn_unref(conn);
+    conn = NULL;
+    k_sem_give(&disconnected);
+}
+
+static void central_phy_updated(struct bt_conn *c, struct bt_conn_le_phy_info *param)
+{
+    k_sem_give(&phy_done);
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+    .connected = central_connected,
+    .disconnected = central_disconnected,
+    .le_phy_updated = central_phy_updated,
+};
+
+static void mtu_exchanged(struct bt_conn *c, uint8_t err, struct bt_gatt_exchange_params *params)
+{
+    if (err)
+        FAIL("MTU exchange failed (err %d)\n", err);
+    k_sem_give(&mtu_done);
+}
+
+/* Discovery: the CCC sits right after each value in the remote service (bt.c) */
+static uint16_t value_handle;
+
+static uint8_t chrc_found(struct bt_conn *c, const struct bt_gatt_attr *attr, struct bt_gatt_discover_params *params)
+{
+    if (attr)
+        value_handle = ((struct bt_gatt_chrc *)attr->user_data)->value_handle;
+    k_sem_give(&discovered);
+    return BT_GATT_ITER_STOP;
+}
+
+static uint16_t discover(const struct bt_uuid *uuid)
+{
+    static struct bt_gatt_discover_params params;
+
+    value_handle = 0;
+    params.uuid = uuid;
+    params.func = chrc_found;
+    params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    int err = bt_gatt_discover(conn, &params);
+    if (err || k_sem_take(&discovered, RSP_TIMEOUT))
+        return 0;
+    return value_handle;
+}
+
+/* Notifications */
+static uint8_t data_notified(struct bt_conn *c, struct bt_gatt_subscribe_params *params, const void *data, uint16_t len)
+{
+    if (data == NULL)
+        return BT_GATT_ITER_STOP;
+
+    if (len != MIN(DATA_LEN, mtu - 3))
+        rx.bad_len++;
+
+    // the first RMS value changes with every snapshot the peripheral encodes
+    uint16_t rms = sys_get_le16(data);
+    if (rx.count && rms == rx.last_rms)
+        rx.stale++;
+    rx.last_rms = rms;
+    rx.count++;
+    rx.bytes += len;
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t message_notified(struct bt_conn *c, struct bt_gatt_subscribe_params *params, const void *data, uint16_t len)
+{
+    if (data == NULL)
+        return BT_GATT_ITER_STOP;
+
+    if (len > mtu - 3)
+        oversized++;
+    rsp_len = MIN(len, sizeof(rsp));
+    memcpy(rsp, data, rsp_len);
+    k_sem_give(&rsp_ready);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static struct bt_gatt_subscribe_params data_sub = {.notify = data_notified, .value = BT_GATT_CCC_NOTIFY};
+static struct bt_gatt_subscribe_params message_sub = {.notify = message_notified, .value = BT_GATT_CCC_NOTIFY};
+static uint16_t message_handle;
+
+static int subscribe(struct bt_gatt_subscribe_params *params, uint16_t handle)
+{
+    params->value_handle = handle;
+    params->ccc_handle = handle + 1;
+    return bt_gatt_subscribe(conn, params);
+}
+
+/* Commands: write the request, wait for its response; returns the status byte or -errno */
+static int request(const uint8_t *req, uint16_t len)
+{
+    k_sem_reset(&rsp_ready);
+    int err = bt_gatt_write_without_response(conn, message_handle, req, len, false);
+    if (err)
+        return err;
+    if (k_sem_take(&rsp_ready, RSP_TIMEOUT))
+        return -ETIMEDOUT;
+    if (rsp_len < 2 || rsp[0] != (req[0] | CMD_RSP_FLAG))
+        return -EBADMSG;
+    return rsp[1];
+}
+
+#define REQUEST(...) request((const uint8_t[]){__VA_ARGS__}, sizeof((const uint8_t[]){__VA_ARGS__}))
+
+/* Link stats response: u16 mtu, u32 elapsed, bytes, queued, sent, failed, u16 latency avg, max */
+struct peer_stats
+{
+    uint16_t mtu;
+    uint32_t elapsed_ms;
+    uint32_t bytes;
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t failed;
+    bool has_failed; // cut off by a small MTU
+};
+
+static int get_link_stats(bool reset, struct peer_stats *st)
+{
+    int status = REQUEST(CMD_GET_LINK_STATS, reset);
+    if (status != CMD_STATUS_OK)
+        return status < 0 ? status : -EIO;
+
+    const uint8_t *p = &rsp[2];
+    uint16_t len = rsp_len - 2;
+    if (len != MIN(26, mtu - 3 - 2))
+        return -EMSGSIZE;
+
+    st->mtu = sys_get_le16(&p[0]);
+    st->elapsed_ms = sys_get_le32(&p[2]);
+    st->bytes = sys_get_le32(&p[6]);
+    st->queued = sys_get_le32(&p[10]);
+    st->sent = sys_get_le32(&p[14]);
+    st->has_failed = len >= 22;
+    st->failed = st->has_failed ? sys_get_le32(&p[18]) : 0;
+    return 0;
+}
+
+/* One PHY: switch, stream for STREAM_TIME_MS, compare both ends */
+struct phy_step
+{
+    const char *name;
+    uint8_t phy;
+};
+
+static const struct phy_step phys[] = {
+    {"1M", BT_GAP_LE_PHY_1M},
+    {"2M", BT_GAP_LE_PHY_2M},
+    {"Coded", BT_GAP_LE_PHY_CODED},
+};
+
+static int set_phy(uint8_t phy)
+{
+    struct bt_conn_info info;
+
+    int err = bt_conn_get_info(conn, &info);
+    if (err)
+        return err;
+    if (info.le.phy->tx_phy == phy && info.le.phy->rx_phy == phy)
+        return 0;
+
+    struct bt_conn_le_phy_param param = {.options = BT_CONN_LE_PHY_OPT_NONE, .pref_tx_phy = phy, .pref_rx_phy = phy};
+    k_sem_reset(&phy_done);
+    err = bt_conn_le_phy_update(conn, &param);
+    if (err)
+        return err;
+    if (k_sem_take(&phy_done, K_SECONDS(10)))
+        return -ETIMEDOUT;
+
+    bt_conn_get_info(conn, &info);
+    return info.le.phy->tx_phy == phy && info.le.phy->rx_phy == phy ? 0 : -EIO;
+}
+
+static int run_phy(const struct phy_step *step)
+{
+    struct peer_stats peer;
+    int err = set_phy(step->phy);
+    if (err)
+    {
+        FAIL("PHY %s: update failed (err %d)\n", step->name, err);
+        return err;
+    }
+
+    // notifications queued before the reset arrive ahead of its response
+    err = get_link_stats(true, &peer);
+    if (err)
+    {
+        FAIL("PHY %s: link stats reset failed (%d)\n", step->name, err);
+        return err;
+    }
+    rx = (struct rx_stats){0};
+
+    int64_t start = k_uptime_get();
+    if (REQUEST(CMD_STREAM_START, STREAM_PERIOD_MS & 0xff, STREAM_PERIOD_MS >> 8) != CMD_STATUS_OK)
+    {
+        FAIL("PHY %s: stream start refused\n", step->name);
+        return -EIO;
+    }
+    k_sleep(K_MSEC(STREAM_TIME_MS));
+    if (REQUEST(CMD_STREAM_STOP) != CMD_STATUS_OK)
+    {
+        FAIL("PHY %s: stream stop refused\n", step->name);
+        return -EIO;
+    }
+    uint32_t elapsed_ms = k_uptime_get() - start;
+
+    err = get_link_stats(false, &peer);
+    if (err)
+    {
+        FAIL("PHY %s: link stats failed (%d)\n", step->name, err);
+        return err;
+    }
+
+    bs_trace_raw_time(2, "MTU %u PHY %s: %u notifications of %u B, %u bit/s, peer queued %u sent %u failed %u\n",
+                      mtu, step->name, rx.count, MIN(DATA_LEN, mtu - 3),
+                      (uint32_t)((uint64_t)rx.bytes * 8 * 1000 / elapsed_ms), peer.queued, peer.sent, peer.failed);
+
+    if (peer.mtu != mtu)
+        FAIL("PHY %s: peer reports MTU %u, expected %u\n", step->name, peer.mtu, mtu);
+    else if (rx.bad_len)
+        FAIL("PHY %s: %u notifications not %u bytes long\n", step->name, rx.bad_len, MIN(DATA_LEN, mtu - 3));
+    else if (rx.stale)
+        FAIL("PHY %s: %u notifications repeated the previous snapshot\n", step->name, rx.stale);
+    else if (rx.count != peer.queued || rx.bytes != peer.bytes)
+        FAIL("PHY %s: received %u (%u B), peer queued %u (%u B)\n", step->name, rx.count, rx.bytes, peer.queued, peer.bytes);
+    else if (peer.failed)
+        FAIL("PHY %s: peer failed to queue %u notifications\n", step->name, peer.failed);
+    else if (rx.count < STREAM_TIME_MS / STREAM_PERIOD_MS * 8 / 10)
+        FAIL("PHY %s: only %u notifications in %u ms\n", step->name, rx.count, elapsed_ms);
+    else
+        return 0;
+    return -EIO;
+}
+
+/* Commands whose responses are sized by the MTU */
+static int run_commands(void)
+{
+    int status = REQUEST(CMD_GET_STATS);
+    int n = MIN(N_INPUT, (mtu - 3 - 2 - 2 - 4) / 12);
+    if (status != CMD_STATUS_OK || rsp_len != 2 + 2 + n * 12 + 4)
+    {
+        FAIL("GET_STATS: status %d, %u bytes, expected %d inputs\n", status, rsp_len, n);
+        return -EIO;
+    }
+
+    // answered later, from the system work queue
+    status = REQUEST(CMD_GET_MEMORY);
+    if (status != CMD_STATUS_OK || rsp_len < 2 + 3 || rsp_len != 2 + 3 + rsp[4] * 12 || rsp[4] == 0)
+    {
+        FAIL("GET_MEMORY: status %d, %u bytes\n", status, rsp_len);
+        return -EIO;
+    }
+
+    if (REQUEST(CMD_RESET) != CMD_STATUS_OK)
+    {
+        FAIL("RESET refused\n");
+        return -EIO;
+    }
+
+    // 0x03 was SET_SAMPLE_RATE
+    status = REQUEST(0x03, 0, 0);
+    if (status != CMD_STATUS_UNKNOWN_OPCODE)
+    {
+        FAIL("Retired opcode 0x03: status %d\n", status);
+        return -EIO;
+    }
+    return 0;
+}
+
+static void test_main(void)
+{
+    int err = bt_enable(NULL);
+    if (err)
+    {
+        FAIL("Bluetooth init failed (err %d)\n", err);
+        return;
+    }
+
+    err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+    if (err)
+    {
+        FAIL("Scanning failed to start (err %d)\n", err);
+        return;
+    }
+    k_sem_take(&connected, K_FOREVER);
+
+    static struct bt_gatt_exchange_params exchange = {.func = mtu_exchanged};
+    err = bt_gatt_exchange_mtu(conn, &exchange);
+    if (err == 0)
+        k_sem_take(&mtu_done, K_FOREVER);
+    else if (err != -EALREADY)
+    {
+        FAIL("MTU exchange failed to start (err %d)\n", err);
+        return;
+    }
+    mtu = bt_gatt_get_mtu(conn);
+    if (mtu != CONFIG_BT_L2CAP_TX_MTU)
+    {
+        FAIL("ATT MTU %u, expected %u\n", mtu, CONFIG_BT_L2CAP_TX_MTU);
+        return;
+    }
+
+    uint16_t data_handle = discover(BT_UUID_REMOTE_DATA_CHRC);
+    message_handle = discover(BT_UUID_REMOTE_MESSAGE_CHRC);
+    if (!data_handle || !message_handle)
+    {
+        FAIL("Remote service not found\n");
+        return;
+    }
+    if (subscribe(&message_sub, message_handle) || subscribe(&data_sub, data_handle))
+    {
+        FAIL("Could not subscribe\n");
+        return;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(phys); i++)
+    {
+        if (run_phy(&phys[i]) || run_commands())
+            return;
+    }
+
+    if (oversized)
+    {
+        FAIL("%u responses longer than MTU - 3\n", oversized);
+        return;
+    }
+
+    bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    k_sem_take(&disconnected, K_FOREVER);
+    PASS("MTU %u swept over %d PHYs\n", mtu, (int)ARRAY_SIZE(phys));
+}
+
+static void test_init(void)
+{
+    bst_ticker_set_next_tick_absolute(WAIT_TIME_S * 1e6);
+    bst_result = In_progress;
+}
+
+static void test_tick(bs_time_t HW_device_time)
+{
+    if (bst_result != Passed)
+        FAIL("Test did not pass within %d seconds\n", WAIT_TIME_S);
+}
+
+static const struct bst_test_instance test_defs[] = {
+    {
+        .test_id = "central",
+        .test_descr = "Streams over every PHY at the configured MTU and checks the command responses",
+        .test_post_init_f = test_init,
+        .test_tick_f = test_tick,
+        .test_main_f = test_main,
+    },
+    BSTEST_END_MARKER,
+};
+
+static struct bst_test_list *test_central_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_defs);
+}
+
+bst_test_install_t test_installers[] = {test_central_install, NULL};
+
+int main(void)
+{
+    bst_main();
+    return 0;
+}
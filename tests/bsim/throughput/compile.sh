@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# Builds the peripheral and one central per ATT MTU into ${BSIM_OUT_PATH}/bin
+set -ue
+: "${ZEPHYR_BASE:?ZEPHYR_BASE must be set to point to the zephyr root directory}"
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be defined}"
+
+source ${ZEPHYR_BASE}/tests/bsim/compile.source
+
+app_root=$(cd "$(dirname "${BASH_SOURCE[0]}")/../../.." && pwd)
+
+app=tests/bsim/throughput/peripheral exe_name=bs_${BOARD_TS}_throughput_peripheral compile
+for mtu in 23 65 247; do
+  app=tests/bsim/throughput/central conf_overlay=mtu_${mtu}.conf \
+    exe_name=bs_${BOARD_TS}_throughput_central_mtu_${mtu} compile
+done
+wait_for_background_jobs
@@ -0,0 +1,161 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+#include "bs_types.h"
+#include "bs_tracing.h"
+#include "bstests.h"
+#include "bt.h"
+#include "cmd.h"
+#include "history.h"
+#include "pipeline.h"
+#include "state.h"
+#include "battery.h"
+#include "wave.h"
+
+/*
+ * Device side of the throughput test: the application's GATT service,
+ * notify path and command channel (bt.c, cmd.c, link.c) over the simulated
+ * radio. The signal path is replaced by the stand-ins below; the scripted
+ * central in ../central does the measuring.
+ */
+
+extern enum bst_result_t bst_result;
+
+#define WAIT_TIME_S 60
+
+#define FAIL(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Failed;                     \
+        bs_trace_error_time_line(__VA_ARGS__);   \
+    } while (0)
+
+#define PASS(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Passed;                     \
+        bs_trace_info_time(1, __VA_ARGS__);      \
+    } while (0)
+
+/* Stand-ins for the signal path; the RMS values count up so every snapshot differs */
+static uint32_t snapshots;
+
+void pipeline_results_get(struct pipeline_results *res)
+{
+    memset(res, 0, sizeof(*res));
+    snapshots++;
+    for (int i = 0; i < N_BLE; i++)
+        res->rms_mv[i] = snapshots + i;
+}
+
+uint32_t pipeline_overruns(void)
+{
+    return 0;
+}
+
+void pipeline_reset(void)
+{
+}
+
+int pipeline_blocks_max_used(void)
+{
+    return 0;
+}
+
+bool state_is_active(void)
+{
+    return true;
+}
+
+uint8_t battery_get_level(void)
+{
+    return 100;
+}
+
+int history_read(enum history_level level, int led, int start, struct history_bucket *out, int max)
+{
+    return 0;
+}
+
+const struct event_capture *event_get_latest(void)
+{
+    return NULL;
+}
+
+int wave_set_frequency(uint32_t freq_mhz)
+{
+    return -ENOTSUP;
+}
+
+int wave_set_amplitude(uint16_t amplitude)
+{
+    return -ENOTSUP;
+}
+
+/* The central disconnects once it is done with every PHY */
+static K_SEM_DEFINE(disconnected, 0, 1);
+
+static void test_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    on_disconnected(conn, reason);
+    k_sem_give(&disconnected);
+}
+
+static struct bt_conn_cb conn_callbacks = {
+    .connected = on_connected,
+    .disconnected = test_disconnected,
+    .le_param_updated = on_le_param_updated,
+};
+
+static struct bt_remote_srv_cb remote_callbacks = {
+    .notif_changed = on_notif_changed,
+    .data_rx = on_data_rx,
+};
+
+static void test_main(void)
+{
+    int err = bluetooth_init(&conn_callbacks, &remote_callbacks);
+    if (err)
+    {
+        FAIL("Bluetooth init failed (err %d)\n", err);
+        return;
+    }
+
+    k_sem_take(&disconnected, K_FOREVER);
+    PASS("Peripheral served the central\n");
+}
+
+static void test_init(void)
+{
+    bst_ticker_set_next_tick_absolute(WAIT_TIME_S * 1e6);
+    bst_result = In_progress;
+}
+
+static void test_tick(bs_time_t HW_device_time)
+{
+    if (bst_result != Passed)
+        FAIL("Test did not pass within %d seconds\n", WAIT_TIME_S);
+}
+
+static const struct bst_test_instance test_defs[] = {
+    {
+        .test_id = "peripheral",
+        .test_descr = "Application notify path and command channel",
+        .test_post_init_f = test_init,
+        .test_tick_f = test_tick,
+        .test_main_f = test_main,
+    },
+    BSTEST_END_MARKER,
+};
+
+static struct bst_test_list *test_peripheral_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_defs);
+}
+
+bst_test_install_t test_installers[] = {test_peripheral_install, NULL};
+
+int main(void)
+{
+    bst_main();
+    return 0;
+}
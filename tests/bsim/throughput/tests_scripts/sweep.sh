@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# One simulation per ATT MTU; each central sweeps 1M, 2M and Coded PHY
+set -ue
+source ${ZEPHYR_BASE}/tests/bsim/sh_common.source
+
+verbosity_level=2
+EXECUTE_TIMEOUT=120
+
+cd ${BSIM_OUT_PATH}/bin
+
+for mtu in 23 65 247; do
+  simulation_id="throughput_mtu_${mtu}"
+
+  Execute ./bs_${BOARD_TS}_throughput_peripheral \
+    -v=${verbosity_level} -s=${simulation_id} -d=0 -testid=peripheral -RealEncryption=0
+
+  Execute ./bs_${BOARD_TS}_throughput_central_mtu_${mtu} \
+    -v=${verbosity_level} -s=${simulation_id} -d=1 -testid=central -RealEncryption=0
+
+  Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} -D=2 -sim_length=60e6 $@
+
+  wait_for_background_jobs
+done
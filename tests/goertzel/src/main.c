@@ -0,0 +1,85 @@
+#include <zephyr/ztest.h>
+#include <math.h>
+#include "goertzel.h"
+#include "macros.h"
+
+/*
+ * Fixed-point Goertzel detectors of tools/goertzel.c against a
+ * double-precision evaluation of the same window. Sines up to the full
+ * int16_t range of the raw counts are fed at each target frequency and at
+ * several phases; the detector state grows to about A*n / (2*sin(w)), so
+ * this is where the intermediate products are largest.
+ */
+
+#define FS_HZ FRAME_FS_HZ
+#define N CONFIG_GOERTZEL_N
+#define PHASES 21
+
+static const uint16_t freqs[N_GOERTZEL] = GOERTZEL_FREQS_HZ;
+static int16_t window[N];
+
+/* Amplitude of the window at f_hz, with the same cos() rounding as the detector */
+static double reference_amplitude(double coeff, const int16_t *x, int n)
+{
+    double s1 = 0, s2 = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        double s0 = x[i] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    return 2 * sqrt(power > 0 ? power : 0) / n;
+}
+
+static void check_sine(int amplitude)
+{
+    struct goertzel g;
+
+    for (int f = 0; f < N_GOERTZEL; f++)
+    {
+        for (int ph = 0; ph < PHASES; ph++)
+        {
+            double phase = 2 * M_PI * ph / PHASES;
+
+            for (int i = 0; i < N; i++)
+                window[i] = lround(amplitude * sin(2 * M_PI * freqs[f] * i / FS_HZ + phase));
+
+            // scale 1.0, so mag_mv[] is in input counts
+            zassert_ok(goertzel_init(&g, freqs, N_GOERTZEL, FS_HZ, N, 1 << 16));
+            zassert_true(goertzel_process(&g, window, N), "window of %d samples did not complete", N);
+
+            double ref = reference_amplitude(g.coeff_q14[f] / (double)(1 << 14), window, N);
+            zassert_true(fabs(g.mag_mv[f] - ref) <= 1 + ref * 1e-3,
+                         "%d Hz, amplitude %d, phase %d/%d: %d counts, reference %d",
+                         freqs[f], amplitude, ph, PHASES, g.mag_mv[f], (int)ref);
+        }
+    }
+}
+
+ZTEST(goertzel, test_full_scale)
+{
+    check_sine(INT16_MAX);
+}
+
+ZTEST(goertzel, test_input1_full_scale)
+{
+    // 14-bit, 4x oversampled: +/-50 mV at gain 4
+    check_sine(2731);
+}
+
+ZTEST(goertzel, test_small_signal)
+{
+    check_sine(20);
+}
+
+ZTEST(goertzel, test_rejects_above_nyquist)
+{
+    struct goertzel g;
+    const uint16_t f = FS_HZ / 2;
+
+    zassert_equal(goertzel_init(&g, &f, 1, FS_HZ, N, 1 << 16), -EINVAL);
+}
+
+ZTEST_SUITE(goertzel, NULL, NULL, NULL, NULL, NULL);
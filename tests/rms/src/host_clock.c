@@ -0,0 +1,15 @@
+/*
+ * Host side of the native_sim benchmark clock. Built into the native
+ * simulator runner against the host C library, so it reads the host's
+ * monotonic clock rather than the simulated one.
+ */
+#include <stdint.h>
+#include <time.h>
+
+uint64_t host_clock_ns(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
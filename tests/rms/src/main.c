@@ -0,0 +1,353 @@
+#include <zephyr/ztest.h>
+#include <stdbool.h>
+#include <math.h>
+#include "rms.h"
+#include "history.h"
+#include "imath.h"
+
+#if !defined(CONFIG_ARCH_POSIX)
+#include <zephyr/timing/timing.h>
+#endif
+
+/*
+ * Sliding-window engine of tools/rms.c against a reference model. Known and
+ * pseudo-random sequences are fed through rms_add_frames() for more than two
+ * laps of the FIFO, in blocks of varying length; at checkpoints the running
+ * sums must match a direct sum over the FIFO contents and each window RMS must match
+ * a double-precision RMS of each window.
+ */
+
+/* Checkpoints per FIFO lap, plus the samples on either side of each wraparound */
+#define CHECKS_PER_LAP 7
+#define LAPS 2
+
+/* Calibration used for the check, so scaling and offset are exercised too */
+#define CHECK_SCALE_Q16 ((int32_t)(3.3 * (1 << 16)))
+#define CHECK_OFFSET_MV 7
+
+/* Block lengths cycled through while feeding, so splits land everywhere */
+static const int block_lens[] = {1, 7, CONFIG_BLOCK_SIZE, 61, 2, 256, 13};
+#define BLOCK_MAX 256
+
+static rms_frame_t block[BLOCK_MAX];
+
+enum pattern
+{
+    PAT_RANDOM,       // uniform over the full range
+    PAT_MAX,          // pure DC at the top of the range
+    PAT_MIN,          // pure DC at the bottom (negative)
+    PAT_ALTERNATE,    // full-scale square wave
+    PAT_RAMP,         // sawtooth through the range
+    PAT_OFFSET_NOISE, // small noise on a large DC offset
+};
+
+static uint32_t lcg;
+
+static int rand_in(int lo, int hi)
+{
+    lcg = lcg * 1664525u + 1013904223u;
+    return lo + (int)((lcg >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+static int pattern_value(enum pattern pat, int k, int lo, int hi)
+{
+    switch (pat)
+    {
+    case PAT_RANDOM:
+        return rand_in(lo, hi);
+    case PAT_MAX:
+        return hi;
+    case PAT_MIN:
+        return lo;
+    case PAT_ALTERNATE:
+        return k & 1 ? hi : lo;
+    case PAT_RAMP:
+        return lo + k % (hi - lo + 1);
+    default:
+        return hi - 8 + rand_in(-4, 4);
+    }
+}
+
+/* Compare the window set of one input against the FIFO */
+static void check_input(int led, enum pattern pat, int k)
+{
+    int head = rms_fifo_head();
+
+    calculate_rms();
+    for (int j = 0; j < T_DATA_S; j++)
+    {
+        int i = (led - 1) * T_DATA_S + j;
+        int start = j * N_VOLTAGE / T_DATA_S;
+        int n = rms_window_len(j);
+
+        // window j holds the j-th oldest slice of the FIFO
+        int64_t sum = 0;
+        uint64_t sumsq = 0;
+        for (int s = start; s < start + n; s++)
+        {
+            int x = rms_fifo_sample(led, head + s);
+            sum += x;
+            sumsq += (int64_t)x * x;
+        }
+        int64_t win_sum;
+        uint64_t win_sumsq;
+        rms_window_sums(i, &win_sum, &win_sumsq);
+        zassert_true(sum == win_sum && sumsq == win_sumsq,
+                     "pattern %d, sample %d, window %d: sums %lld/%llu, expected %lld/%llu",
+                     pat, k, i, win_sum, win_sumsq, sum, sumsq);
+
+        double mean = (double)sum / n;
+        double ms = (double)sumsq / n;
+        if (IS_ENABLED(CONFIG_RMS_AC_COUPLED))
+            ms -= mean * mean;
+        double ref = sqrt(ms > 0 ? ms : 0) * CHECK_SCALE_Q16 / (1 << 16) + CHECK_OFFSET_MV;
+        ref = ref < 0 ? 0 : (ref > UINT16_MAX ? UINT16_MAX : ref);
+
+        // the integer path floors twice, so it may sit up to 1 mV below
+        uint16_t mv = rms_window_mv(i);
+        zassert_true(mv <= ref + 1e-6 && mv >= ref - 1.0 - 1e-6,
+                     "pattern %d, sample %d, window %d: RMS %d mV, reference %f mV",
+                     pat, k, i, mv, ref);
+    }
+}
+
+static bool is_checkpoint(int k)
+{
+    int in_lap = k % N_VOLTAGE;
+
+    return in_lap % (N_VOLTAGE / CHECKS_PER_LAP) == 0 || in_lap == 1 || in_lap == N_VOLTAGE - 1;
+}
+
+/* Every input gets the full range of the stored sample type */
+static void run_pattern(enum pattern pat)
+{
+    int n = 0;
+    int b = 0;
+
+    lcg = 0x2545f491u + pat;
+    for (int k = 0; k < LAPS * N_VOLTAGE + N_VOLTAGE / 3; k++)
+    {
+        for (int led = 1; led <= N_INPUT; led++)
+            rms_frame_set(&block[n], led - 1, pattern_value(pat, k, RMS_SAMPLE_MIN, RMS_SAMPLE_MAX));
+
+        // a block ends at its length or at a checkpoint, whichever comes first
+        if (++n < block_lens[b] && !is_checkpoint(k))
+            continue;
+        rms_add_frames(block, n);
+        n = 0;
+        b = (b + 1) % ARRAY_SIZE(block_lens);
+
+        if (!is_checkpoint(k))
+            continue;
+        for (int led = 1; led <= N_INPUT; led++)
+            check_input(led, pat, k);
+    }
+}
+
+static void rms_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    rms_reset();
+    history_reset();
+    for (int led = 1; led <= N_INPUT; led++)
+        rms_set_calibration(led, CHECK_SCALE_Q16, CHECK_OFFSET_MV);
+}
+
+ZTEST(rms, test_window_lengths)
+{
+    int total = 0;
+
+    for (int j = 0; j < T_DATA_S; j++)
+        total += rms_window_len(j);
+    zassert_equal(total, N_VOLTAGE, "windows cover %d of %d samples", total, N_VOLTAGE);
+}
+
+ZTEST(rms, test_random)
+{
+    run_pattern(PAT_RANDOM);
+}
+
+ZTEST(rms, test_full_scale_positive)
+{
+    run_pattern(PAT_MAX);
+}
+
+ZTEST(rms, test_full_scale_negative)
+{
+    run_pattern(PAT_MIN);
+}
+
+ZTEST(rms, test_square_wave)
+{
+    run_pattern(PAT_ALTERNATE);
+}
+
+ZTEST(rms, test_ramp)
+{
+    run_pattern(PAT_RAMP);
+}
+
+ZTEST(rms, test_offset_noise)
+{
+    run_pattern(PAT_OFFSET_NOISE);
+}
+
+ZTEST(rms, test_isqrt64)
+{
+    const uint64_t values[] = {0, 1, 2, 3, 4, 15, 16, 17, 0xffffffffull, 1ull << 62, UINT64_MAX};
+
+    for (int i = 0; i < ARRAY_SIZE(values); i++)
+    {
+        uint64_t r = isqrt64(values[i]);
+
+        // (r + 1)^2 does not fit in 64 bits for the largest root
+        zassert_true(r * r <= values[i] && (r == UINT32_MAX || (r + 1) * (r + 1) > values[i]),
+                     "isqrt64(%llu) = %llu", values[i], r);
+    }
+}
+
+/*
+ * Per-sample update of one input with its own FIFO: the layout before frames,
+ * kept for timing. It stores the same sample width as the frames. The engine
+ * FIFO already takes most of the RAM on target, so there the baseline FIFO is
+ * an eighth of a lap; the nRF52833 has no data cache, so its access cost does
+ * not depend on the FIFO length.
+ */
+#if defined(CONFIG_ARCH_POSIX)
+#define PLANAR_LEN N_VOLTAGE
+#else
+#define PLANAR_LEN (N_VOLTAGE / 8)
+#endif
+
+#if defined(CONFIG_RMS_SAMPLE_16BIT)
+static int16_t planar[N_INPUT][PLANAR_LEN];
+
+static inline int planar_get(int ch, int pos)
+{
+    return planar[ch][pos];
+}
+
+static inline void planar_set(int ch, int pos, int v)
+{
+    planar[ch][pos] = v;
+}
+#else
+static int8_t planar_hi[N_INPUT][PLANAR_LEN];
+static uint8_t planar_lo[N_INPUT][(PLANAR_LEN + 1) / 2]; // two consecutive samples per byte
+
+static inline int planar_get(int ch, int pos)
+{
+    return planar_hi[ch][pos] * 16 + ((planar_lo[ch][pos / 2] >> (pos % 2 * 4)) & 0xf);
+}
+
+static inline void planar_set(int ch, int pos, int v)
+{
+    int s = pos % 2 * 4;
+
+    planar_hi[ch][pos] = v >> 4;
+    planar_lo[ch][pos / 2] = (planar_lo[ch][pos / 2] & ~(0xf << s)) | ((v & 0xf) << s);
+}
+#endif
+
+static int planar_head[N_INPUT];
+static uint64_t planar_sqsum[N_BLE];
+static int64_t planar_sum[N_BLE];
+
+static void planar_add(int ch, int val)
+{
+    uint64_t *ss = &planar_sqsum[ch * T_DATA_S];
+    int64_t *s = &planar_sum[ch * T_DATA_S];
+    int i0 = planar_head[ch];
+    int64_t old = planar_get(ch, i0);
+
+    for (int j = 0; j < T_DATA_S - 1; j++)
+    {
+        int64_t next = planar_get(ch, (i0 + (j + 1) * PLANAR_LEN / T_DATA_S) % PLANAR_LEN);
+        ss[j] += next * next - old * old;
+        s[j] += next - old;
+        old = next;
+    }
+    ss[T_DATA_S - 1] += (int64_t)val * val - old * old;
+    s[T_DATA_S - 1] += val - old;
+
+    planar_set(ch, i0, val);
+    planar_head[ch] = (i0 + 1) % PLANAR_LEN;
+}
+
+/* Random blocks fed over and over, generated before the clock starts */
+#define BENCH_POOL 8
+#define BENCH_BLOCKS (N_VOLTAGE / CONFIG_BLOCK_SIZE)
+
+static rms_frame_t pool[BENCH_POOL][CONFIG_BLOCK_SIZE];
+static int16_t pool_samples[BENCH_POOL][CONFIG_BLOCK_SIZE][N_INPUT];
+
+static void planar_lap(void)
+{
+    for (int i = 0; i < BENCH_BLOCKS; i++)
+        for (int k = 0; k < CONFIG_BLOCK_SIZE; k++)
+            for (int ch = 0; ch < N_INPUT; ch++)
+                planar_add(ch, pool_samples[i % BENCH_POOL][k][ch]);
+}
+
+static void frames_lap(void)
+{
+    for (int i = 0; i < BENCH_BLOCKS; i++)
+        rms_add_frames(pool[i % BENCH_POOL], CONFIG_BLOCK_SIZE);
+}
+
+#if defined(CONFIG_ARCH_POSIX)
+/* src/host_clock.c, built against the host C library */
+uint64_t host_clock_ns(void);
+#endif
+
+/*
+ * Wall time of one call. native_sim does not advance the kernel clocks while
+ * code runs, so it reads the host clock; on target the timing API counts
+ * cycles of a hardware counter.
+ */
+static uint64_t time_ns(void (*fn)(void))
+{
+#if defined(CONFIG_ARCH_POSIX)
+    uint64_t start = host_clock_ns();
+    fn();
+    return host_clock_ns() - start;
+#else
+    timing_t start = timing_counter_get();
+    fn();
+    timing_t end = timing_counter_get();
+    return timing_cycles_to_ns(timing_cycles_get(&start, &end));
+#endif
+}
+
+/* One FIFO lap of random frames in CONFIG_BLOCK_SIZE blocks through both layouts */
+ZTEST(rms, test_benchmark)
+{
+    const int n_frames = BENCH_BLOCKS * CONFIG_BLOCK_SIZE;
+
+    lcg = 0x9e3779b9u;
+    for (int i = 0; i < BENCH_POOL; i++)
+        for (int k = 0; k < CONFIG_BLOCK_SIZE; k++)
+            for (int ch = 0; ch < N_INPUT; ch++)
+            {
+                pool_samples[i][k][ch] = rand_in(RMS_SAMPLE_MIN, RMS_SAMPLE_MAX);
+                rms_frame_set(&pool[i][k], ch, pool_samples[i][k][ch]);
+            }
+
+#if !defined(CONFIG_ARCH_POSIX)
+    timing_init();
+    timing_start();
+#endif
+    uint64_t planar_ns = time_ns(planar_lap);
+    uint64_t frames_ns = time_ns(frames_lap);
+#if !defined(CONFIG_ARCH_POSIX)
+    timing_stop();
+#endif
+
+    TC_PRINT("RMS engine, %d inputs of %d-bit samples, blocks of %d frames\n", N_INPUT,
+             IS_ENABLED(CONFIG_RMS_SAMPLE_16BIT) ? 16 : 12, CONFIG_BLOCK_SIZE);
+    TC_PRINT("  per-sample: %u ns/frame\n", (unsigned int)(planar_ns / n_frames));
+    TC_PRINT("  frames:     %u ns/frame\n", (unsigned int)(frames_ns / n_frames));
+}
+
+ZTEST_SUITE(rms, NULL, NULL, rms_before, NULL, NULL);
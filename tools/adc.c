@@ -1,30 +1,115 @@
+#include <zephyr/kernel.h>
 #include <zephyr/drivers/adc.h>
 #include <zephyr/logging/log.h>
+#include "adc.h"
+#include "bench.h"
 LOG_MODULE_REGISTER(adc, LOG_LEVEL_INF);
 
-int read_adc(struct adc_dt_spec adc_channel) {
+#define SAADC_CHANNELS 8
+
+/* Acquisition time per SAADC channel, including hardware oversampling */
+BENCH_DEFINE(adc_ch0);
+BENCH_DEFINE(adc_ch1);
+BENCH_DEFINE(adc_ch2);
+BENCH_DEFINE(adc_ch3);
+BENCH_DEFINE(adc_ch4);
+BENCH_DEFINE(adc_ch5);
+BENCH_DEFINE(adc_ch6);
+BENCH_DEFINE(adc_ch7);
+static struct bench *const adc_bench[SAADC_CHANNELS] = {
+	&adc_ch0, &adc_ch1, &adc_ch2, &adc_ch3, &adc_ch4, &adc_ch5, &adc_ch6, &adc_ch7,
+};
+
+/* Per-channel sequence, built once so a read is just adc_read() */
+struct adc_chan {
+	struct adc_sequence sequence;
 	int16_t buf;
-	int32_t val_mv;
+	int32_t scale_q16; // mV per raw count, Q16
+	bool ready;
+};
+static struct adc_chan chans[SAADC_CHANNELS];
+
+/* SAADC offset calibration: once at boot, then every CONFIG_ADC_CALIB_PERIOD_S */
+static atomic_t calib_pending = ATOMIC_INIT(1);
+
+static void calib_expiry(struct k_timer *timer)
+{
+	adc_request_calibration();
+}
+K_TIMER_DEFINE(calib_timer, calib_expiry, NULL);
+
+void adc_request_calibration(void)
+{
+	atomic_set(&calib_pending, 1);
+}
+
+int adc_prepare(const struct adc_dt_spec *adc_channel)
+{
+	if (adc_channel->channel_id >= SAADC_CHANNELS)
+		return -EINVAL;
+
+	struct adc_chan *ch = &chans[adc_channel->channel_id];
+
+	ch->sequence.buffer = &ch->buf;
+	ch->sequence.buffer_size = sizeof(ch->buf);
+	// picks up zephyr,resolution and zephyr,oversampling of the channel
+	int err = adc_sequence_init_dt(adc_channel, &ch->sequence);
+	if (err)
+		return err;
+
+	int32_t scale = 1 << 16;
+	err = adc_raw_to_millivolts_dt(adc_channel, &scale);
+	if (err)
+		return err;
+	ch->scale_q16 = scale;
+	ch->ready = true;
+
+	if (CONFIG_ADC_CALIB_PERIOD_S > 0)
+		k_timer_start(&calib_timer, K_SECONDS(CONFIG_ADC_CALIB_PERIOD_S),
+			      K_SECONDS(CONFIG_ADC_CALIB_PERIOD_S));
 
-	struct adc_sequence sequence = {
-		.buffer = &buf,
-		.buffer_size = sizeof(buf),
-	};
+	LOG_DBG("Channel %d: %d mV per 65536 counts", adc_channel->channel_id, scale);
+	return 0;
+}
 
-	(void)adc_sequence_init_dt(&adc_channel, &sequence);
+int read_adc_raw(const struct adc_dt_spec *adc_channel, int16_t *raw)
+{
+	struct adc_chan *ch = &chans[adc_channel->channel_id];
 
-	int err = adc_read(adc_channel.dev, &sequence);
-	if (err < 0) LOG_ERR("Could not read(%d)", err);
-	else LOG_DBG("Raw ADC Buffer: %d", buf);
+	if (!ch->ready)
+		return -ENODEV;
 
-	val_mv = buf;
-	err = adc_raw_to_millivolts_dt(&adc_channel, &val_mv);
+	// offset calibration applies to the whole SAADC, any channel can run it
+	ch->sequence.calibrate = atomic_cas(&calib_pending, 1, 0);
+
+	uint32_t start = bench_start();
+	int err = adc_read(adc_channel->dev, &ch->sequence);
+	bench_stop(adc_bench[adc_channel->channel_id], start);
+
+	if (ch->sequence.calibrate)
+		LOG_DBG("SAADC offset calibrated");
 	if (err < 0) {
-		LOG_ERR("Buffer cannot be converted to mV; returning raw buffer value.");
-		return buf;
-	}
-	else {
-		LOG_DBG("%s (channel %d)\t%d mV", adc_channel.dev->name, adc_channel.channel_id, val_mv);
-		return val_mv;
+		LOG_ERR("Could not read(%d)", err);
+		return err;
 	}
-}
\ No newline at end of file
+
+	*raw = ch->buf;
+	return 0;
+}
+
+int read_adc(const struct adc_dt_spec *adc_channel) {
+	int16_t buf;
+
+	int err = read_adc_raw(adc_channel, &buf);
+	if (err < 0) return 0;
+	LOG_DBG("Raw ADC Buffer: %d", buf);
+
+	int32_t val_mv = (buf * chans[adc_channel->channel_id].scale_q16) >> 16;
+	LOG_DBG("%s (channel %d)\t%d mV", adc_channel->dev->name, adc_channel->channel_id, val_mv);
+	return val_mv;
+}
+
+int32_t adc_scale_q16(const struct adc_dt_spec *adc_channel)
+{
+	return chans[adc_channel->channel_id].scale_q16;
+}
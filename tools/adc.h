@@ -1,3 +1,13 @@
+#ifndef ADC_H
+#define ADC_H
+
 #include <zephyr/drivers/adc.h>
 
-int read_adc(struct adc_dt_spec adc_channel);
+/* Functions */
+int adc_prepare(const struct adc_dt_spec *adc_channel);
+int read_adc_raw(const struct adc_dt_spec *adc_channel, int16_t *raw);
+int read_adc(const struct adc_dt_spec *adc_channel);
+int32_t adc_scale_q16(const struct adc_dt_spec *adc_channel);
+void adc_request_calibration(void);
+
+#endif
@@ -0,0 +1,86 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "battery.h"
+#include "adc.h"
+#include "bt.h"
+#include "lut.h"
+#include "state.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(battery, LOG_LEVEL_INF);
+
+static const struct adc_dt_spec *batt_adc;
+static int32_t filtered_mv_q8 = -1; // low-pass filtered pin voltage, Q8
+static uint8_t reported = BATT_LEVEL_UNKNOWN;
+
+/*
+ * The battery channel shares the SAADC with the signal inputs, so its reads
+ * are made by the acquisition loop between frames (battery_poll()), one per
+ * frame, instead of blocking the loop for a whole sample.
+ */
+static atomic_t reads_left;
+static int32_t read_sum;
+
+static void battery_sample(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(battery_work, battery_sample);
+static void battery_process(struct k_work *work);
+static K_WORK_DEFINE(process_work, battery_process);
+
+static void battery_sample(struct k_work *work)
+{
+    k_work_reschedule(&battery_work, K_MSEC(CONFIG_BATT_PERIOD_MS));
+
+    // the pin voltage is not meaningful while charging; a sample already in progress finishes first
+    if (!state_is_active() || atomic_get(&reads_left))
+        return;
+
+    read_sum = 0;
+    atomic_set(&reads_left, CONFIG_BATT_OVERSAMPLE);
+}
+
+void battery_poll(void)
+{
+    if (atomic_get(&reads_left) == 0)
+        return;
+
+    read_sum += read_adc(batt_adc);
+    if (atomic_dec(&reads_left) == 1)
+        k_work_submit(&process_work);
+}
+
+static void battery_process(struct k_work *work)
+{
+    int32_t mv_q8 = (read_sum << 8) / CONFIG_BATT_OVERSAMPLE;
+
+    if (filtered_mv_q8 < 0)
+        filtered_mv_q8 = mv_q8;
+    else
+        filtered_mv_q8 += (mv_q8 - filtered_mv_q8) >> CONFIG_BATT_FILTER_SHIFT;
+
+    uint8_t level = lut_batt_percent(filtered_mv_q8 >> 8);
+    LOG_DBG("Battery pin %d mV (filtered %d mV) -> %d %%", mv_q8 >> 8, filtered_mv_q8 >> 8, level);
+
+    if (reported != BATT_LEVEL_UNKNOWN && level >= reported &&
+        level < reported + CONFIG_BATT_HYST_PCT)
+        return;
+    if (level == reported)
+        return;
+
+    reported = level;
+    bluetooth_set_battery_level(level);
+}
+
+int battery_init(const struct adc_dt_spec *adc)
+{
+    if (adc == NULL)
+        return -EINVAL;
+
+    batt_adc = adc;
+    k_work_schedule(&battery_work, K_NO_WAIT);
+    return 0;
+}
+
+uint8_t battery_get_level(void)
+{
+    return reported;
+}
@@ -0,0 +1,13 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <zephyr/drivers/adc.h>
+
+#define BATT_LEVEL_UNKNOWN 0xFF
+
+/* Functions */
+int battery_init(const struct adc_dt_spec *adc);
+uint8_t battery_get_level(void);
+void battery_poll(void);
+
+#endif
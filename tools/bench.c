@@ -0,0 +1,57 @@
+#include <zephyr/logging/log.h>
+#include "bench.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(bench, LOG_LEVEL_INF);
+
+static struct bench *benches[CONFIG_BENCH_MAX];
+static int n_benches;
+
+static void bench_report_work(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(report_work, bench_report_work);
+
+void bench_stop(struct bench *b, uint32_t start)
+{
+    uint32_t cycles = k_cycle_get_32() - start;
+
+    if (!b->registered)
+    {
+        unsigned int key = irq_lock();
+        if (n_benches < CONFIG_BENCH_MAX)
+        {
+            benches[n_benches++] = b;
+            if (n_benches == 1)
+                k_work_schedule(&report_work, K_MSEC(CONFIG_BENCH_REPORT_MS));
+        }
+        b->registered = true;
+        irq_unlock(key);
+    }
+
+    b->count++;
+    b->cycles += cycles;
+    if (cycles > b->max)
+        b->max = cycles;
+}
+
+void bench_report(void)
+{
+    for (int i = 0; i < n_benches; i++)
+    {
+        struct bench *b = benches[i];
+        if (b->count == 0)
+            continue;
+
+        uint32_t avg_ns = k_cyc_to_ns_floor64(b->cycles / b->count);
+        uint32_t max_ns = k_cyc_to_ns_floor64(b->max);
+        LOG_INF("%s: n=%d avg=%d ns max=%d ns", b->name, b->count, avg_ns, max_ns);
+        b->count = 0;
+        b->cycles = 0;
+        b->max = 0;
+    }
+}
+
+static void bench_report_work(struct k_work *work)
+{
+    bench_report();
+    k_work_reschedule(&report_work, K_MSEC(CONFIG_BENCH_REPORT_MS));
+}
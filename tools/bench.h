@@ -0,0 +1,38 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <zephyr/kernel.h>
+
+/* Cycle-count statistics for one code section, reported periodically when CONFIG_BENCH=y */
+struct bench
+{
+    const char *name;
+    uint32_t count;
+    uint64_t cycles;
+    uint32_t max;
+    bool registered;
+};
+
+#define BENCH_DEFINE(_name) static struct bench _name = {.name = #_name}
+
+#if defined(CONFIG_BENCH)
+static inline uint32_t bench_start(void)
+{
+    return k_cycle_get_32();
+}
+void bench_stop(struct bench *b, uint32_t start);
+void bench_report(void);
+#else
+static inline uint32_t bench_start(void)
+{
+    return 0;
+}
+static inline void bench_stop(struct bench *b, uint32_t start)
+{
+    ARG_UNUSED(b);
+    ARG_UNUSED(start);
+}
+static inline void bench_report(void) {}
+#endif
+
+#endif
@@ -1,5 +1,13 @@
+#include <zephyr/sys/byteorder.h>
 #include "bt.h"
 #include "macros.h"
+#include "cmd.h"
+#include "rms.h"
+#include "battery.h"
+#include "setup.h"
+#include "link.h"
+#include "state.h"
+#include "pipeline.h"
 
 LOG_MODULE_REGISTER(bt, LOG_LEVEL_INF);
 
@@ -7,20 +15,74 @@ static K_SEM_DEFINE(bt_init_ok, 1, 1);
 
 #define DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
-static uint16_t data[N_BLE] = {0};
+
+/*
+ * Data snapshots: RMS windows, then spectrum magnitudes. Only this snapshot
+ * is pooled; sample blocks are not streamed over BLE. Each set_data() call
+ * copies the values once into a fresh buffer from the pool and publishes it
+ * as the current snapshot. Reads and notifications take a reference and use
+ * the buffer in place, so it is not copied per connection or overwritten
+ * while a notification built from it is still queued; the reference is
+ * dropped in on_sent().
+ */
+#define DATA_LEN ((N_BLE + N_SPECTRUM) * sizeof(uint16_t))
+NET_BUF_POOL_DEFINE(snapshot_pool, CONFIG_BT_SNAPSHOT_BUFS, DATA_LEN, 0, NULL);
+static struct net_buf *snapshot;
+static struct k_spinlock snapshot_lock;
+static const uint16_t no_data[N_BLE + N_SPECTRUM]; // read before the first snapshot
+
+/*
+ * Data notification throughput per connection. Notifications complete in
+ * order, so queue times are kept in a small FIFO and matched in on_sent();
+ * if more are outstanding than it holds, timing pauses until it drains.
+ */
+#define STATS_INFLIGHT 8
+struct link_timing
+{
+    uint32_t queued_ms[STATS_INFLIGHT];
+    uint8_t head;
+    uint8_t count;
+    bool overflow;
+};
+static struct bt_link_stats link_stats[CONFIG_BT_MAX_CONN];
+static struct link_timing link_timing[CONFIG_BT_MAX_CONN];
+static struct k_spinlock stats_lock;
+
 static struct bt_remote_srv_cb remote_service_callbacks;
 enum bt_data_notifications_enabled notifications_enabled;
 
+/*
+ * Broadcast: manufacturer-specific advertising data, refreshed every
+ * CONFIG_BT_BROADCAST_PERIOD_MS so receivers can monitor without connecting.
+ * [company ID (LE)][state][battery %][counter][RMS mV per input (u16 LE)]
+ */
+#define BROADCAST_HDR_LEN 5
+static uint8_t mfg_data[BROADCAST_HDR_LEN + N_INPUT * sizeof(uint16_t)];
+#if defined(CONFIG_BT_BROADCAST)
+// flags, name and manufacturer data (2 header bytes each) share the 31-byte advertising payload
+BUILD_ASSERT(3 + 2 + DEVICE_NAME_LEN + 2 + sizeof(mfg_data) <= 31,
+             "Too many inputs (or too long a name) for the broadcast payload");
+#endif
+
 /* Advertising data */
 static const struct bt_data ad[] = {
     BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
-    BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN)};
+    BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
+#if defined(CONFIG_BT_BROADCAST)
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, mfg_data, sizeof(mfg_data)),
+#endif
+};
 
 /* Scan response data */
 static const struct bt_data sd[] = {
     BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_REMOTE_SERV_VAL),
 };
 
+/* Attribute indices of the characteristic values in remote_srv */
+#define ATTR_DATA 2
+#define ATTR_MESSAGE 5
+#define ATTR_EVENT 8
+
 /* Setup services */
 BT_GATT_SERVICE_DEFINE(remote_srv,
                        BT_GATT_PRIMARY_SERVICE(BT_UUID_REMOTE_SERVICE),
@@ -30,9 +92,15 @@ BT_GATT_SERVICE_DEFINE(remote_srv,
                                               read_data_cb, NULL, NULL),
                        BT_GATT_CCC(data_ccc_cfg_changed_cb, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
                        BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_MESSAGE_CHRC,
-                                              BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                                              BT_GATT_CHRC_WRITE_WITHOUT_RESP | BT_GATT_CHRC_NOTIFY,
                                               BT_GATT_PERM_WRITE,
-                                              NULL, on_write, NULL), );
+                                              NULL, on_write, NULL),
+                       BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_EVENT_CHRC,
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_READ,
+                                              read_event_cb, NULL, NULL),
+                       BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
 
 /* Callbacks */
 void data_ccc_cfg_changed_cb(const struct bt_gatt_attr *attr, uint16_t value)
@@ -48,9 +116,35 @@ void data_ccc_cfg_changed_cb(const struct bt_gatt_attr *attr, uint16_t value)
     }
 }
 
+static struct net_buf *snapshot_get(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&snapshot_lock);
+    struct net_buf *snap = snapshot ? net_buf_ref(snapshot) : NULL;
+    k_spin_unlock(&snapshot_lock, key);
+
+    return snap;
+}
+
 ssize_t read_data_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
 {
-    return bt_gatt_attr_read(conn, attr, buf, len, offset, &data, sizeof(data));
+    struct net_buf *snap = snapshot_get();
+
+    if (snap == NULL)
+        return bt_gatt_attr_read(conn, attr, buf, len, offset, no_data, sizeof(no_data));
+
+    ssize_t ret = bt_gatt_attr_read(conn, attr, buf, len, offset, snap->data, snap->len);
+    net_buf_unref(snap);
+    return ret;
+}
+
+/* Latest event capture; up to 512 bytes, fetched by the phone with a long read */
+ssize_t read_event_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
+{
+    const struct event_capture *cap = event_get_latest();
+
+    if (cap == NULL)
+        return bt_gatt_attr_read(conn, attr, buf, len, offset, NULL, 0);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, cap, sizeof(*cap));
 }
 
 ssize_t on_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
@@ -64,10 +158,72 @@ ssize_t on_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const vo
     return len;
 }
 
+static void stats_queued(struct bt_conn *conn, uint16_t len, int ret)
+{
+    uint8_t i = bt_conn_index(conn);
+    struct bt_link_stats *st = &link_stats[i];
+    struct link_timing *t = &link_timing[i];
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    if (ret)
+    {
+        st->failed++;
+    }
+    else
+    {
+        st->queued++;
+        st->bytes += len;
+        if (t->count < STATS_INFLIGHT && !t->overflow)
+            t->queued_ms[(t->head + t->count++) % STATS_INFLIGHT] = k_uptime_get_32();
+        else
+            t->overflow = true;
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+
+static void stats_sent(struct bt_conn *conn)
+{
+    uint8_t i = bt_conn_index(conn);
+    struct bt_link_stats *st = &link_stats[i];
+    struct link_timing *t = &link_timing[i];
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    st->sent++;
+    if (t->count)
+    {
+        uint32_t latency = k_uptime_get_32() - t->queued_ms[t->head];
+        t->head = (t->head + 1) % STATS_INFLIGHT;
+        t->count--;
+        st->timed++;
+        st->latency_sum_ms += latency;
+        st->latency_max_ms = MAX(st->latency_max_ms, latency);
+    }
+    if (t->count == 0)
+        t->overflow = false;
+    k_spin_unlock(&stats_lock, key);
+}
+
+void bt_link_stats_get(struct bt_conn *conn, struct bt_link_stats *out, bool reset)
+{
+    uint8_t i = bt_conn_index(conn);
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *out = link_stats[i];
+    out->elapsed_ms = k_uptime_get_32() - link_stats[i].elapsed_ms;
+    if (reset)
+    {
+        link_stats[i] = (struct bt_link_stats){.elapsed_ms = k_uptime_get_32()};
+        link_timing[i] = (struct link_timing){0};
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+
 void on_sent(struct bt_conn *conn, void *user_data)
 {
-    ARG_UNUSED(user_data);
-    LOG_INF("Notification sent on connection %p", (void *)conn);
+    stats_sent(conn);
+    // release the snapshot the notification was built from
+    net_buf_unref((struct net_buf *)user_data);
+    LOG_DBG("Notification sent on connection %p", (void *)conn);
 }
 
 void bt_ready(int ret)
@@ -81,25 +237,133 @@ int send_data_notification(struct bt_conn *conn, uint16_t length)
 {
     int ret = 0;
 
+    // on_sent() runs once per connection, so the target must be explicit
+    if (conn == NULL)
+        return -ENOTCONN;
+
+    struct net_buf *snap = snapshot_get();
+    if (snap == NULL)
+        return -ENODATA;
+
     struct bt_gatt_notify_params params = {0};
-    const struct bt_gatt_attr *attr = &remote_srv.attrs[2];
+    const struct bt_gatt_attr *attr = &remote_srv.attrs[ATTR_DATA];
 
     params.attr = attr;
-    params.data = &data;
-    params.len = length;
+    params.data = snap->data;
+    params.len = MIN(length, snap->len);
     params.func = on_sent;
+    params.user_data = snap;
 
     ret = bt_gatt_notify_cb(conn, &params);
+    stats_queued(conn, params.len, ret);
+    if (ret)
+        net_buf_unref(snap);
 
     return ret;
 }
 
-void set_data(uint16_t *data_in)
+/* Fan the current snapshot out to every connection subscribed to the data characteristic */
+struct fanout
+{
+    int sent;
+    int err;
+};
+
+static void notify_subscriber(struct bt_conn *conn, void *user_data)
 {
-    memcpy(data, data_in, sizeof(data));
-    LOG_INF("Data set via memcpy (size = %d).", sizeof(data));
+    struct fanout *f = user_data;
+
+    if (!bt_gatt_is_subscribed(conn, &remote_srv.attrs[ATTR_DATA], BT_GATT_CCC_NOTIFY))
+        return;
+
+    int ret = send_data_notification(conn, data_notification_len(conn));
+    if (ret)
+        f->err = ret;
+    else
+        f->sent++;
+}
+
+int send_data_notification_all(void)
+{
+    struct fanout f = {0};
+
+    bt_conn_foreach(BT_CONN_TYPE_LE, notify_subscriber, &f);
+
+    // number of subscribers notified, or the error if none could be
+    return f.sent ? f.sent : f.err;
+}
+
+/* Notify the capture header to every subscribed connection; samples are read on demand */
+int send_event_notification(const struct event_capture *cap)
+{
+    const struct bt_gatt_attr *attr = &remote_srv.attrs[ATTR_EVENT];
+
+    return bt_gatt_notify(NULL, attr, cap, EVENT_HEADER_LEN);
+}
+
+/* Command responses go back on the message characteristic */
+int send_message_notification(struct bt_conn *conn, const uint8_t *buf, uint16_t len)
+{
+    return bt_gatt_notify(conn, &remote_srv.attrs[ATTR_MESSAGE], buf, len);
+}
+
+void set_data(const uint16_t *rms_in, const uint16_t *mags_in)
+{
+    struct net_buf *snap = net_buf_alloc(&snapshot_pool, K_NO_WAIT);
+    if (snap == NULL)
+    {
+        // every buffer is still queued for sending; keep the previous snapshot
+        LOG_WRN("No free snapshot buffer");
+        return;
+    }
+
+    net_buf_add_mem(snap, rms_in, N_BLE * sizeof(uint16_t));
+    net_buf_add_mem(snap, mags_in, N_SPECTRUM * sizeof(uint16_t));
+
+    k_spinlock_key_t key = k_spin_lock(&snapshot_lock);
+    struct net_buf *old = snapshot;
+    snapshot = snap;
+    k_spin_unlock(&snapshot_lock, key);
+
+    if (old)
+        net_buf_unref(old);
+    LOG_INF("Data snapshot set (size = %d).", snap->len);
+}
+
+uint16_t data_notification_len(struct bt_conn *conn)
+{
+    // one ATT notification carries at most MTU - 3 bytes
+    return MIN(DATA_LEN, bt_gatt_get_mtu(conn) - 3);
 }
 
+static void broadcast_fill(void)
+{
+    static uint8_t counter;
+    struct pipeline_results res;
+
+    pipeline_results_get(&res);
+
+    sys_put_le16(BT_COMPANY_ID, &mfg_data[0]);
+    mfg_data[2] = state_is_active() ? 0 : 1;
+    mfg_data[3] = battery_get_level();
+    mfg_data[4] = counter++; // lets receivers drop repeated advertisements
+    for (int ch = 0; ch < N_INPUT; ch++)
+        sys_put_le16(res.stats[ch].rms_mv, &mfg_data[BROADCAST_HDR_LEN + 2 * ch]);
+}
+
+static void broadcast_work_handler(struct k_work *work)
+{
+    broadcast_fill();
+
+    // fails while no advertising set is running (all connection slots in use)
+    int ret = bt_le_adv_update_data(ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+    if (ret)
+        LOG_DBG("Advertising data not updated (ret = %d)", ret);
+
+    k_work_schedule(k_work_delayable_from_work(work), K_MSEC(CONFIG_BT_BROADCAST_PERIOD_MS));
+}
+static K_WORK_DELAYABLE_DEFINE(broadcast_work, broadcast_work_handler);
+
 int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_srv_cb *remote_cb)
 {
     int ret;
@@ -108,7 +372,7 @@ int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_srv_cb *remote_cb)
 
     if ((bt_cb == NULL) | (remote_cb == NULL))
     {
-        return -NRFX_ERROR_NULL;
+        return -EINVAL;
     }
     bt_conn_cb_register(bt_cb);
     remote_service_callbacks.notif_changed = remote_cb->notif_changed;
@@ -126,6 +390,9 @@ int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_srv_cb *remote_cb)
 
     if (IS_ENABLED(CONFIG_BT_SETTINGS)) settings_load();
 
+    // the first advertisements already carry a valid broadcast, not zeros
+    if (IS_ENABLED(CONFIG_BT_BROADCAST))
+        broadcast_fill();
     ret = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
     if (ret)
     {
@@ -133,37 +400,42 @@ int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_srv_cb *remote_cb)
         return ret;
     }
 
+    if (IS_ENABLED(CONFIG_BT_BROADCAST))
+        k_work_schedule(&broadcast_work, K_MSEC(CONFIG_BT_BROADCAST_PERIOD_MS));
+
     return ret;
 }
 
-struct bt_conn *current_conn;
 void on_data_rx(struct bt_conn *conn, const uint16_t *const data, uint16_t len)
 {
-    // manually append NULL character at the end
-    uint8_t temp_str[len + 1];
-    memcpy(temp_str, data, len);
-    temp_str[len] = 0x00;
-
     LOG_INF("BT received data on conn %p. Len: %d", (void *)conn, len);
-    LOG_INF("Data: %s", temp_str);
+    cmd_dispatch(conn, (const uint8_t *)data, len);
 }
 
 void on_connected(struct bt_conn *conn, uint8_t ret)
 {
     if (ret)
+    {
         LOG_ERR("Connection error: %d", ret);
-    LOG_INF("BT connected");
-    current_conn = bt_conn_ref(conn);
+        return;
+    }
+    LOG_INF("BT connected (conn %d)", bt_conn_index(conn));
+    link_connected(conn);
+
+    struct bt_link_stats discard;
+    bt_link_stats_get(conn, &discard, true);
 }
 
 void on_disconnected(struct bt_conn *conn, uint8_t reason)
 {
-    LOG_INF("BT disconnected (reason: %d)", reason);
-    if (current_conn)
-    {
-        bt_conn_unref(current_conn);
-        current_conn = NULL;
-    }
+    LOG_INF("BT disconnected (conn %d, reason: %d)", bt_conn_index(conn), reason);
+    cmd_stream_stop(conn);
+    link_disconnected(conn);
+}
+
+void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    link_param_updated(conn, interval, latency, timeout);
 }
 
 void on_notif_changed(enum bt_data_notifications_enabled status)
@@ -184,17 +456,9 @@ uint8_t bluetooth_get_battery_level(void){
     return battery_level;
 }
 
-void bluetooth_set_battery_level(int level, int nominal_batt_level){
-    LOG_DBG("Battery Voltage: %d", level);
+void bluetooth_set_battery_level(uint8_t level){
+    LOG_DBG("Battery Percentage: %d %%", level);
 
-    // Assume battery voltage is reduced by 0.48648649x via external hardware (i.e. 3.7V -> 1.8V)
-    float normalized_level = (float)level * 100.0 / (nominal_batt_level * 0.48648649);
-    if (normalized_level > 100) normalized_level = 100;
-    else if (normalized_level < 0) normalized_level = 0;
-
-    LOG_DBG("Battery Percentage: %.2f %%", normalized_level);
-
-    int err = bt_bas_set_battery_level((uint8_t)normalized_level);
+    int err = bt_bas_set_battery_level(level);
     if (err) LOG_ERR("BAS set error (err = %d)", err);
 }
-
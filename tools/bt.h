@@ -11,8 +11,11 @@
 #include <zephyr/bluetooth/hci.h>
 #include <zephyr/settings/settings.h>
 #include <zephyr/bluetooth/services/bas.h>
+#include <zephyr/net/buf.h>
 
 #include "adc.h"
+#include "macros.h"
+#include "event.h"
 
 /* UUID of the Remote Service */
 // Project ID: 0x0000 (3rd entry)
@@ -28,9 +31,17 @@
 #define BT_UUID_REMOTE_MESSAGE_CHRC_VAL \
     BT_UUID_128_ENCODE(0x8fcc2162, 0x4abd, 0x0000, 0x090e, 0x8e22d2fc7eb9)
 
+/* UUID of the Event Characteristic */
+#define BT_UUID_REMOTE_EVENT_CHRC_VAL \
+    BT_UUID_128_ENCODE(0x8fcc2163, 0x4abd, 0x0000, 0x090e, 0x8e22d2fc7eb9)
+
+/* Bluetooth SIG company identifier, also the DIS PnP vendor ID */
+#define BT_COMPANY_ID 0x090e
+
 #define BT_UUID_REMOTE_SERVICE BT_UUID_DECLARE_128(BT_UUID_REMOTE_SERV_VAL)
 #define BT_UUID_REMOTE_DATA_CHRC BT_UUID_DECLARE_128(BT_UUID_REMOTE_DATA_CHRC_VAL)
 #define BT_UUID_REMOTE_MESSAGE_CHRC BT_UUID_DECLARE_128(BT_UUID_REMOTE_MESSAGE_CHRC_VAL)
+#define BT_UUID_REMOTE_EVENT_CHRC BT_UUID_DECLARE_128(BT_UUID_REMOTE_EVENT_CHRC_VAL)
 
 enum bt_data_notifications_enabled
 {
@@ -44,24 +55,44 @@ struct bt_remote_srv_cb
     void (*data_rx)(struct bt_conn *conn, const uint16_t *const data, uint16_t len);
 };
 
+/* Data notification counters of one connection, since connect or the last reset */
+struct bt_link_stats
+{
+    uint32_t elapsed_ms;
+    uint32_t bytes;          // payload accepted by the host
+    uint32_t queued;
+    uint32_t sent;           // completed (on_sent)
+    uint32_t failed;         // refused by the host, e.g. out of buffers
+    uint32_t timed;          // completions with a measured latency
+    uint32_t latency_sum_ms; // queue to completion
+    uint32_t latency_max_ms;
+};
+
 /* Function declarations */
 ssize_t read_data_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset);
 void data_ccc_cfg_changed_cb(const struct bt_gatt_attr *attr, uint16_t value);
 ssize_t on_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
-void bluetooth_set_battery_level(int level, int nominal_batt_mv);
+void bluetooth_set_battery_level(uint8_t level);
 uint8_t bluetooth_get_battery_level(void);
 void on_sent(struct bt_conn *conn, void *user_data);
 void bt_ready(int ret);
 int send_data_notification(struct bt_conn *conn, uint16_t length);
-void set_data(uint16_t *data_in);
+int send_data_notification_all(void);
+void bt_link_stats_get(struct bt_conn *conn, struct bt_link_stats *out, bool reset);
+void set_data(const uint16_t *rms_in, const uint16_t *mags_in);
+ssize_t read_event_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset);
+int send_event_notification(const struct event_capture *cap);
+int send_message_notification(struct bt_conn *conn, const uint8_t *buf, uint16_t len);
+uint16_t data_notification_len(struct bt_conn *conn);
 int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_srv_cb *remote_cb);
 void on_connected(struct bt_conn *conn, uint8_t ret);
 void on_disconnected(struct bt_conn *conn, uint8_t reason);
+void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout);
 void on_notif_changed(enum bt_data_notifications_enabled status);
 void on_data_rx(struct bt_conn *conn, const uint16_t *const data, uint16_t len);
 
 /* Battery */
 uint8_t bluetooth_get_battery_level(void);
-void bluetooth_set_battery_level(int level, int nominal_batt_level);
+void bluetooth_set_battery_level(uint8_t level);
 
 #endif
\ No newline at end of file
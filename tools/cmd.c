@@ -0,0 +1,364 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include "cmd.h"
+#include "bt.h"
+#include "setup.h"
+#include "rms.h"
+#include "history.h"
+#include "battery.h"
+#include "wave.h"
+#include "link.h"
+#include "pipeline.h"
+#include "state.h"
+#include "mem.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(cmd, LOG_LEVEL_INF);
+
+static enum cmd_status cmd_status_of(int ret);
+
+typedef int (*cmd_handler_t)(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                             uint8_t *rsp, uint16_t *rsp_len);
+
+struct cmd_entry
+{
+    uint8_t opcode;
+    uint8_t args_len; // minimum argument length
+    cmd_handler_t handler;
+};
+
+/* Responses are built in place; commands are handled one at a time in the BT RX thread, or answer later (-EINPROGRESS) */
+static uint8_t rsp_buf[CMD_RSP_MAX];
+
+/* Streaming, one entry per connection (indexed by bt_conn_index) */
+struct stream
+{
+    struct bt_conn *conn;
+    uint16_t period_ms;
+    int64_t next_ms;
+};
+
+static struct stream streams[CONFIG_BT_MAX_CONN];
+static K_MUTEX_DEFINE(stream_lock);
+static atomic_t stream_paused; // no acquisition, nothing new to send
+
+static void stream_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(stream_work, stream_work_handler);
+
+static void stream_work_handler(struct k_work *work)
+{
+    if (atomic_get(&stream_paused))
+        return;
+
+    int64_t now = k_uptime_get();
+    int64_t next = INT64_MAX;
+    bool encoded = false;
+
+    k_mutex_lock(&stream_lock, K_FOREVER);
+    for (int i = 0; i < ARRAY_SIZE(streams); i++)
+    {
+        struct stream *s = &streams[i];
+        if (s->conn == NULL)
+            continue;
+
+        if (s->next_ms <= now)
+        {
+            // one snapshot per tick, shared by every connection that is due
+            if (!encoded)
+            {
+                struct pipeline_results res;
+                pipeline_results_get(&res);
+                set_data(res.rms_mv, res.spectrum_mv);
+                encoded = true;
+            }
+            int err = send_data_notification(s->conn, data_notification_len(s->conn));
+            if (err)
+                LOG_DBG("Stream notification failed on conn %d (err: %d)", i, err);
+
+            s->next_ms += s->period_ms;
+            if (s->next_ms <= now) // fell behind; don't burst to catch up
+                s->next_ms = now + s->period_ms;
+        }
+        next = MIN(next, s->next_ms);
+    }
+    k_mutex_unlock(&stream_lock);
+
+    if (next != INT64_MAX)
+        k_work_reschedule(&stream_work, K_MSEC(next - now));
+}
+
+void cmd_stream_pause(bool pause)
+{
+    atomic_set(&stream_paused, pause);
+    if (pause)
+        k_work_cancel_delayable(&stream_work);
+    else
+        k_work_reschedule(&stream_work, K_NO_WAIT);
+}
+
+void cmd_stream_stop(struct bt_conn *conn)
+{
+    struct stream *s = &streams[bt_conn_index(conn)];
+
+    k_mutex_lock(&stream_lock, K_FOREVER);
+    if (s->conn)
+    {
+        bt_conn_unref(s->conn);
+        s->conn = NULL;
+    }
+    k_mutex_unlock(&stream_lock);
+    link_set_streaming(conn, false);
+}
+
+/* Handlers */
+static int cmd_stream_start(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                            uint8_t *rsp, uint16_t *rsp_len)
+{
+    uint16_t period = sys_get_le16(args);
+
+    if (period < CONFIG_CMD_STREAM_MIN_PERIOD_MS)
+        return -EINVAL;
+
+    struct stream *s = &streams[bt_conn_index(conn)];
+
+    cmd_stream_stop(conn);
+    k_mutex_lock(&stream_lock, K_FOREVER);
+    s->conn = bt_conn_ref(conn);
+    s->period_ms = period;
+    s->next_ms = k_uptime_get();
+    k_mutex_unlock(&stream_lock);
+
+    link_set_streaming(conn, true);
+    k_work_reschedule(&stream_work, K_NO_WAIT);
+    return 0;
+}
+
+static int cmd_stream_stop_handler(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                                   uint8_t *rsp, uint16_t *rsp_len)
+{
+    cmd_stream_stop(conn);
+    return 0;
+}
+
+static int cmd_get_stats(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                         uint8_t *rsp, uint16_t *rsp_len)
+{
+    uint8_t *p = rsp;
+    struct pipeline_results res;
+    // whole inputs only, so the phone can count them from the length
+    int n = MIN(N_INPUT, (bt_gatt_get_mtu(conn) - 3 - 2 - 2 - 4) / 12);
+
+    pipeline_results_get(&res);
+    *p++ = state_is_active() ? 0 : 1;
+    *p++ = battery_get_level();
+    for (int ch = 0; ch < n; ch++)
+    {
+        const struct rms_window_stats *st = &res.stats[ch];
+        sys_put_le16(st->rms_mv, p);
+        sys_put_le16(st->dc_mv, p + 2);
+        sys_put_le16(st->min_mv, p + 4);
+        sys_put_le16(st->max_mv, p + 6);
+        sys_put_le16(st->vpp_mv, p + 8);
+        sys_put_le16(st->crest_x100, p + 10);
+        p += 12;
+    }
+    sys_put_le32(pipeline_overruns(), p);
+    p += 4;
+    *rsp_len = p - rsp;
+    return 0;
+}
+
+static int cmd_get_history(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                           uint8_t *rsp, uint16_t *rsp_len)
+{
+    uint8_t level = args[0];
+    uint8_t led = args[1];
+    uint16_t start = sys_get_le16(&args[2]);
+    int max = MIN(CMD_RSP_MAX - 2 - 4, bt_gatt_get_mtu(conn) - 3 - 2 - 4) / sizeof(struct history_bucket);
+
+    int n = history_read(level, led, start, (struct history_bucket *)&rsp[4], max);
+    if (n < 0)
+        return n;
+
+    // echo the request so the phone can page through with start += n
+    rsp[0] = level;
+    rsp[1] = led;
+    sys_put_le16(start, &rsp[2]);
+    *rsp_len = 4 + n * sizeof(struct history_bucket);
+    return 0;
+}
+
+static int cmd_reset(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                     uint8_t *rsp, uint16_t *rsp_len)
+{
+    pipeline_reset();
+    return 0;
+}
+
+static int cmd_set_wave(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                        uint8_t *rsp, uint16_t *rsp_len)
+{
+    if (!IS_ENABLED(CONFIG_WAVE))
+        return -ENOTSUP;
+
+    int err = wave_set_frequency(sys_get_le32(args));
+    if (err)
+        return err;
+    return wave_set_amplitude(sys_get_le16(&args[4]));
+}
+
+static int cmd_get_link_stats(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                              uint8_t *rsp, uint16_t *rsp_len)
+{
+    struct bt_link_stats st;
+
+    bt_link_stats_get(conn, &st, len >= 1 && args[0]);
+
+    sys_put_le16(bt_gatt_get_mtu(conn), &rsp[0]);
+    sys_put_le32(st.elapsed_ms, &rsp[2]);
+    sys_put_le32(st.bytes, &rsp[6]);
+    sys_put_le32(st.queued, &rsp[10]);
+    sys_put_le32(st.sent, &rsp[14]);
+    sys_put_le32(st.failed, &rsp[18]);
+    sys_put_le16(st.timed ? st.latency_sum_ms / st.timed : 0, &rsp[22]);
+    sys_put_le16(MIN(st.latency_max_ms, UINT16_MAX), &rsp[24]);
+    *rsp_len = MIN(26, bt_gatt_get_mtu(conn) - 3 - 2);
+    return 0;
+}
+
+#define MEMORY_ENTRY_LEN 12 // name[8], u16 stack size, u16 unused
+
+/*
+ * The stack scan behind CMD_GET_MEMORY is slow, so it runs on the system
+ * work queue and answers from there instead of holding up the BT RX thread.
+ */
+static struct mem_thread_usage memory_threads[(CMD_RSP_MAX - 2 - 3) / MEMORY_ENTRY_LEN];
+static uint8_t memory_rsp[CMD_RSP_MAX];
+static struct bt_conn *memory_conn;
+static atomic_t memory_busy;
+
+static void memory_work_handler(struct k_work *work);
+static K_WORK_DEFINE(memory_work, memory_work_handler);
+
+static void memory_work_handler(struct k_work *work)
+{
+    struct bt_conn *conn = memory_conn;
+    int max = MIN(ARRAY_SIZE(memory_threads), (bt_gatt_get_mtu(conn) - 3 - 2 - 3) / MEMORY_ENTRY_LEN);
+    int n = mem_thread_usage(memory_threads, max);
+    uint16_t len = 2;
+
+    memory_rsp[0] = CMD_GET_MEMORY | CMD_RSP_FLAG;
+    memory_rsp[1] = cmd_status_of(MIN(n, 0));
+    if (n >= 0)
+    {
+        uint8_t *p = &memory_rsp[2];
+
+        p[0] = pipeline_blocks_max_used();
+        p[1] = CONFIG_PIPELINE_BLOCKS;
+        p[2] = n;
+        for (int i = 0; i < n; i++)
+        {
+            uint8_t *entry = &p[3 + i * MEMORY_ENTRY_LEN];
+            memcpy(entry, memory_threads[i].name, sizeof(memory_threads[i].name));
+            sys_put_le16(memory_threads[i].size, &entry[8]);
+            sys_put_le16(memory_threads[i].unused, &entry[10]);
+        }
+        len += 3 + n * MEMORY_ENTRY_LEN;
+    }
+
+    int err = send_message_notification(conn, memory_rsp, len);
+    if (err)
+        LOG_DBG("Could not send memory report (err: %d)", err);
+    memory_conn = NULL;
+    bt_conn_unref(conn);
+    atomic_clear(&memory_busy);
+}
+
+static int cmd_get_memory(struct bt_conn *conn, const uint8_t *args, uint16_t len,
+                          uint8_t *rsp, uint16_t *rsp_len)
+{
+    if (!IS_ENABLED(CONFIG_MEM_REPORT))
+        return -ENOTSUP;
+    if (!atomic_cas(&memory_busy, 0, 1))
+        return -EBUSY;
+
+    memory_conn = bt_conn_ref(conn);
+    k_work_submit(&memory_work);
+    return -EINPROGRESS;
+}
+
+static const struct cmd_entry cmd_table[] = {
+    {CMD_STREAM_START, 2, cmd_stream_start},
+    {CMD_STREAM_STOP, 0, cmd_stream_stop_handler},
+    {CMD_GET_STATS, 0, cmd_get_stats},
+    {CMD_GET_HISTORY, 4, cmd_get_history},
+    {CMD_RESET, 0, cmd_reset},
+    {CMD_SET_WAVE, 6, cmd_set_wave},
+    {CMD_GET_LINK_STATS, 0, cmd_get_link_stats},
+    {CMD_GET_MEMORY, 0, cmd_get_memory},
+};
+
+static enum cmd_status cmd_status_of(int ret)
+{
+    switch (ret)
+    {
+    case 0:
+        return CMD_STATUS_OK;
+    case -EMSGSIZE:
+        return CMD_STATUS_BAD_LENGTH;
+    case -EINVAL:
+    case -ERANGE:
+        return CMD_STATUS_INVALID;
+    case -ENOTSUP:
+        return CMD_STATUS_UNSUPPORTED;
+    case -EBUSY:
+    case -EAGAIN:
+        return CMD_STATUS_BUSY;
+    default:
+        return CMD_STATUS_FAILED;
+    }
+}
+
+void cmd_dispatch(struct bt_conn *conn, const uint8_t *buf, uint16_t len)
+{
+    if (len == 0)
+        return;
+
+    // history paging and other request bursts run on the fast link profile
+    link_activity(conn);
+
+    const struct cmd_entry *entry = NULL;
+    for (int i = 0; i < ARRAY_SIZE(cmd_table); i++)
+    {
+        if (cmd_table[i].opcode == buf[0])
+        {
+            entry = &cmd_table[i];
+            break;
+        }
+    }
+
+    uint16_t payload_len = 0;
+    enum cmd_status status;
+    int ret = 0;
+    if (entry == NULL)
+        status = CMD_STATUS_UNKNOWN_OPCODE;
+    else if (len - 1 < entry->args_len)
+        status = CMD_STATUS_BAD_LENGTH;
+    else
+    {
+        ret = entry->handler(conn, &buf[1], len - 1, &rsp_buf[2], &payload_len);
+        if (ret == -EINPROGRESS)
+            return; // the handler's work item answers
+        status = cmd_status_of(ret);
+    }
+
+    LOG_DBG("Command 0x%02x (len %d) -> %d, status %d", buf[0], len, ret, status);
+
+    rsp_buf[0] = buf[0] | CMD_RSP_FLAG;
+    rsp_buf[1] = status;
+    int err = send_message_notification(conn, rsp_buf, 2 + payload_len);
+    if (err)
+        LOG_DBG("Could not send response (err: %d)", err);
+}
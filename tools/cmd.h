@@ -0,0 +1,46 @@
+#ifndef CMD_H
+#define CMD_H
+
+#include <zephyr/bluetooth/conn.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Binary command protocol on the message characteristic.
+ * Request:  [opcode][arguments, little endian]
+ * Response: [opcode | CMD_RSP_FLAG][status (enum cmd_status)][payload], notified on the same characteristic
+ */
+#define CMD_RSP_FLAG 0x80
+#define CMD_RSP_MAX 244 // fits the 247-byte ATT MTU
+
+/* Response status byte; handlers return 0 or -errno, which is mapped onto these */
+enum cmd_status
+{
+    CMD_STATUS_OK = 0,
+    CMD_STATUS_UNKNOWN_OPCODE = 1,
+    CMD_STATUS_BAD_LENGTH = 2, // arguments too short
+    CMD_STATUS_INVALID = 3,    // argument out of range
+    CMD_STATUS_UNSUPPORTED = 4, // not available in this build
+    CMD_STATUS_BUSY = 5,
+    CMD_STATUS_FAILED = 0xff, // any other error
+};
+
+enum cmd_opcode
+{
+    CMD_STREAM_START = 0x01, // u16 period_ms, per connection
+    CMD_STREAM_STOP = 0x02,
+    // 0x03 was SET_SAMPLE_RATE; the rate is fixed at build time (FRAME_TICKS)
+    CMD_GET_STATS = 0x04, // -> state, battery, 6 x u16 per input (as many as fit the MTU), u32 dropped samples
+    CMD_GET_HISTORY = 0x05, // u8 level, u8 input, u16 start (0 = newest)
+    CMD_RESET = 0x06, // dropped samples, RMS windows and history
+    CMD_SET_WAVE = 0x07, // u32 freq_mhz, u16 amplitude (0.01 %)
+    CMD_GET_LINK_STATS = 0x08, // [u8 reset], response truncated to the MTU
+    CMD_GET_MEMORY = 0x09, // -> blocks used/total, u8 n, n x (name[8], u16 stack size, u16 unused)
+};
+
+/* Functions */
+void cmd_dispatch(struct bt_conn *conn, const uint8_t *buf, uint16_t len);
+void cmd_stream_stop(struct bt_conn *conn);
+void cmd_stream_pause(bool pause);
+
+#endif
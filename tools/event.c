@@ -0,0 +1,150 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "event.h"
+#include "rms.h"
+#include "bt.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(event, LOG_LEVEL_INF);
+
+#define EVENT_SAMPLES (CONFIG_EVENT_PRE_SAMPLES + CONFIG_EVENT_POST_SAMPLES)
+
+BUILD_ASSERT(sizeof(struct event_capture) <= 512, "capture must fit one GATT attribute");
+BUILD_ASSERT(EVENT_SAMPLES < N_VOLTAGE / T_DATA_S, "capture must stay inside the sample FIFO");
+
+struct event_trigger
+{
+    uint8_t type;
+    uint8_t led;
+    bool active; // condition currently met, re-armed once it clears
+    int lo_mv;
+    int hi_mv;
+    int lo_counts;
+    int32_t scale_q16;
+};
+
+static struct event_trigger triggers[CONFIG_EVENT_TRIGGERS];
+static int n_triggers;
+
+static struct event_capture slots[CONFIG_EVENT_SLOTS];
+static int latest = -1;
+static uint16_t seq;
+
+/* Capture in progress: waiting for the post-trigger samples to reach the FIFO */
+static struct event_trigger *pending;
+static int pending_pos;  // FIFO index of the trigger sample
+static int pending_left; // post-trigger samples still to come
+
+int event_set_trigger(int led, enum event_type type, int lo_mv, int hi_mv, int32_t scale_q16)
+{
+    if (n_triggers >= CONFIG_EVENT_TRIGGERS)
+        return -ENOMEM;
+    if (led < 1 || led > N_INPUT || scale_q16 <= 0)
+        return -EINVAL;
+
+    struct event_trigger *t = &triggers[n_triggers++];
+    t->type = type;
+    t->led = led;
+    t->lo_mv = lo_mv;
+    t->hi_mv = hi_mv;
+    t->lo_counts = ((int64_t)lo_mv << 16) / scale_q16;
+    t->scale_q16 = scale_q16;
+    t->active = false;
+    return 0;
+}
+
+static void start_capture(struct event_trigger *t, int pos)
+{
+    if (pending)
+        return; // one capture at a time
+
+    pending = t;
+    pending_pos = pos;
+    pending_left = CONFIG_EVENT_POST_SAMPLES;
+    LOG_INF("Event %d on input %d", t->type, t->led);
+}
+
+static void finish_capture(void)
+{
+    int slot = (latest + 1) % CONFIG_EVENT_SLOTS;
+    struct event_capture *cap = &slots[slot];
+
+    cap->type = pending->type;
+    cap->led = pending->led;
+    cap->seq = seq++;
+    cap->timestamp_ms = k_uptime_get_32();
+    cap->scale_q16 = pending->scale_q16;
+    cap->n_pre = CONFIG_EVENT_PRE_SAMPLES;
+    cap->n_post = CONFIG_EVENT_POST_SAMPLES;
+    for (int i = 0; i < EVENT_SAMPLES; i++)
+    {
+        cap->samples[i] = rms_fifo_sample(cap->led, pending_pos - CONFIG_EVENT_PRE_SAMPLES + i);
+    }
+
+    latest = slot;
+    pending = NULL;
+
+    int err = send_event_notification(cap);
+    if (err && err != -ENOTCONN)
+        LOG_ERR("Could not notify event (err: %d)", err);
+}
+
+static bool update_level(struct event_trigger *t, bool cond)
+{
+    bool fire = cond && !t->active;
+    t->active = cond;
+    return fire;
+}
+
+/* Call after the last n samples of input led went into the FIFO and the RMS was updated */
+void event_process_block(int led, int n)
+{
+    int head = rms_fifo_head();
+    int first = head - n;
+
+    if (pending && pending->led == led)
+    {
+        pending_left -= n;
+        if (pending_left <= 0)
+            finish_capture();
+    }
+
+    for (int k = 0; k < n_triggers; k++)
+    {
+        struct event_trigger *t = &triggers[k];
+        if (t->led != led)
+            continue;
+
+        switch (t->type)
+        {
+        case EVENT_TRIG_EDGE_RISING:
+            for (int i = 0; i < n; i++)
+            {
+                if (rms_fifo_sample(led, first + i - 1) < t->lo_counts && rms_fifo_sample(led, first + i) >= t->lo_counts)
+                {
+                    start_capture(t, first + i);
+                    break;
+                }
+            }
+            break;
+        case EVENT_TRIG_RMS_ABOVE:
+            if (update_level(t, rms_window_mv(led * T_DATA_S - 1) > t->lo_mv))
+                start_capture(t, head - 1);
+            break;
+        case EVENT_TRIG_VPP_RANGE:
+        {
+            int vpp = rms_last_window(led)->vpp_mv;
+            if (update_level(t, vpp < t->lo_mv || vpp > t->hi_mv))
+                start_capture(t, head - 1);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+const struct event_capture *event_get_latest(void)
+{
+    return latest < 0 ? NULL : &slots[latest];
+}
@@ -0,0 +1,35 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+enum event_type
+{
+    EVENT_TRIG_RMS_ABOVE = 1,  // window RMS rises above lo_mv
+    EVENT_TRIG_EDGE_RISING,    // a sample crosses lo_mv upwards
+    EVENT_TRIG_VPP_RANGE,      // window Vpp leaves [lo_mv, hi_mv]
+};
+
+/* Capture slot: header followed by pre- and post-trigger samples (raw stored counts) */
+struct event_capture
+{
+    uint8_t type;
+    uint8_t led;
+    uint16_t seq;
+    uint32_t timestamp_ms;
+    int32_t scale_q16; // mV per count, Q16
+    uint16_t n_pre;
+    uint16_t n_post;
+    int16_t samples[CONFIG_EVENT_PRE_SAMPLES + CONFIG_EVENT_POST_SAMPLES];
+} __packed;
+
+#define EVENT_HEADER_LEN offsetof(struct event_capture, samples)
+
+/* Functions */
+int event_set_trigger(int led, enum event_type type, int lo_mv, int hi_mv, int32_t scale_q16);
+void event_process_block(int led, int n);
+const struct event_capture *event_get_latest(void);
+
+#endif
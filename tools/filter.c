@@ -0,0 +1,132 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <math.h>
+#include "filter.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(filter, LOG_LEVEL_INF);
+
+// coefficients of a normalized biquad reach |2|, so they are stored halved
+#define FILTER_POST_SHIFT 1
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static void filter_reinit(struct filter *f)
+{
+    memset(f->state, 0, sizeof(f->state));
+#if defined(CONFIG_CMSIS_DSP_FILTERING)
+    arm_biquad_cascade_df1_init_q15(&f->inst, f->n_stages, f->coeffs, f->state, f->post_shift);
+#endif
+}
+
+void filter_init(struct filter *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->post_shift = FILTER_POST_SHIFT;
+    filter_reinit(f);
+}
+
+int filter_add_stage(struct filter *f, const int16_t coeffs[FILTER_COEFFS_PER_STAGE])
+{
+    if (f->n_stages >= FILTER_STAGES_MAX)
+        return -ENOMEM;
+
+    memcpy(&f->coeffs[f->n_stages * FILTER_COEFFS_PER_STAGE], coeffs,
+           FILTER_COEFFS_PER_STAGE * sizeof(int16_t));
+    f->n_stages++;
+    filter_reinit(f);
+    return 0;
+}
+
+static int16_t to_q15(double c)
+{
+    double scaled = c / (1 << FILTER_POST_SHIFT) * 32768.0;
+    if (scaled > INT16_MAX)
+        return INT16_MAX;
+    if (scaled < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)lround(scaled);
+}
+
+/* RBJ audio-EQ-cookbook designs, evaluated once in floating point */
+static int add_rbj(struct filter *f, bool notch, int f0_hz, int q_x10, int fs_hz)
+{
+    if (f0_hz <= 0 || q_x10 <= 0 || 2 * f0_hz >= fs_hz)
+        return -EINVAL;
+
+    double w0 = 2 * M_PI * f0_hz / fs_hz;
+    double alpha = sin(w0) / (2.0 * q_x10 / 10.0);
+    double a0 = 1 + alpha;
+    double b0 = notch ? 1 : alpha;
+    double b1 = notch ? -2 * cos(w0) : 0;
+    double b2 = notch ? 1 : -alpha;
+
+    const int16_t coeffs[FILTER_COEFFS_PER_STAGE] = {
+        to_q15(b0 / a0), 0, to_q15(b1 / a0), to_q15(b2 / a0),
+        to_q15(2 * cos(w0) / a0), to_q15(-(1 - alpha) / a0)};
+
+    LOG_DBG("%s %d Hz Q=%d/10 fs=%d: %d %d %d %d %d", notch ? "notch" : "bandpass", f0_hz, q_x10, fs_hz,
+            coeffs[0], coeffs[2], coeffs[3], coeffs[4], coeffs[5]);
+    return filter_add_stage(f, coeffs);
+}
+
+int filter_add_notch(struct filter *f, int f0_hz, int q_x10, int fs_hz)
+{
+    return add_rbj(f, true, f0_hz, q_x10, fs_hz);
+}
+
+int filter_add_bandpass(struct filter *f, int f0_hz, int q_x10, int fs_hz)
+{
+    return add_rbj(f, false, f0_hz, q_x10, fs_hz);
+}
+
+#if !defined(CONFIG_CMSIS_DSP_FILTERING)
+/* Same arithmetic as arm_biquad_cascade_df1_q15(): 64-bit accumulator, saturated output */
+static void biquad_df1_q15(const int16_t *c, int16_t *st, int8_t post_shift,
+                           const int16_t *in, int16_t *out, size_t n)
+{
+    int32_t x1 = st[0], x2 = st[1], y1 = st[2], y2 = st[3];
+
+    for (size_t i = 0; i < n; i++)
+    {
+        int32_t x0 = in[i];
+        int64_t acc = (int64_t)c[0] * x0 + (int64_t)c[2] * x1 + (int64_t)c[3] * x2 +
+                      (int64_t)c[4] * y1 + (int64_t)c[5] * y2;
+        int32_t y0 = (int32_t)(acc >> (15 - post_shift));
+
+        y0 = y0 > INT16_MAX ? INT16_MAX : (y0 < INT16_MIN ? INT16_MIN : y0);
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+        out[i] = y0;
+    }
+
+    st[0] = x1;
+    st[1] = x2;
+    st[2] = y1;
+    st[3] = y2;
+}
+#endif
+
+void filter_process(struct filter *f, const int16_t *in, int16_t *out, size_t n)
+{
+    if (f->n_stages == 0)
+    {
+        if (out != in)
+            memcpy(out, in, n * sizeof(int16_t));
+        return;
+    }
+
+#if defined(CONFIG_CMSIS_DSP_FILTERING)
+    arm_biquad_cascade_df1_q15(&f->inst, (q15_t *)in, out, n);
+#else
+    for (int s = 0; s < f->n_stages; s++)
+    {
+        biquad_df1_q15(&f->coeffs[s * FILTER_COEFFS_PER_STAGE], &f->state[s * FILTER_STATE_PER_STAGE],
+                       f->post_shift, s == 0 ? in : out, out, n);
+    }
+#endif
+}
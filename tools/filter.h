@@ -0,0 +1,34 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(CONFIG_CMSIS_DSP_FILTERING)
+#include <arm_math.h>
+#endif
+
+#define FILTER_STAGES_MAX 2
+#define FILTER_COEFFS_PER_STAGE 6 // {b0, 0, b1, b2, -a1, -a2} in Q15 / 2^post_shift
+#define FILTER_STATE_PER_STAGE 4  // {x[n-1], x[n-2], y[n-1], y[n-2]}
+
+/* Biquad cascade (direct form I, Q15) run over one block of samples per call */
+struct filter
+{
+    int16_t coeffs[FILTER_STAGES_MAX * FILTER_COEFFS_PER_STAGE];
+    int16_t state[FILTER_STAGES_MAX * FILTER_STATE_PER_STAGE];
+    uint8_t n_stages;
+    int8_t post_shift;
+#if defined(CONFIG_CMSIS_DSP_FILTERING)
+    arm_biquad_casd_df1_inst_q15 inst;
+#endif
+};
+
+/* Functions */
+void filter_init(struct filter *f);
+int filter_add_notch(struct filter *f, int f0_hz, int q_x10, int fs_hz);
+int filter_add_bandpass(struct filter *f, int f0_hz, int q_x10, int fs_hz);
+int filter_add_stage(struct filter *f, const int16_t coeffs[FILTER_COEFFS_PER_STAGE]);
+void filter_process(struct filter *f, const int16_t *in, int16_t *out, size_t n);
+
+#endif
@@ -0,0 +1,69 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <math.h>
+#include "goertzel.h"
+#include "imath.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(goertzel, LOG_LEVEL_INF);
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+int goertzel_init(struct goertzel *g, const uint16_t *freqs_hz, int n_freqs, int fs_hz, int n, int32_t scale_q16)
+{
+    if (n_freqs > GOERTZEL_FREQS_MAX || n <= 0 || fs_hz <= 0)
+        return -EINVAL;
+
+    memset(g, 0, sizeof(*g));
+    for (int k = 0; k < n_freqs; k++)
+    {
+        if (2 * freqs_hz[k] >= fs_hz)
+            return -EINVAL;
+        g->coeff_q14[k] = lround(2 * cos(2 * M_PI * freqs_hz[k] / fs_hz) * (1 << 14));
+    }
+    g->n_freqs = n_freqs;
+    g->n = n;
+    g->scale_q16 = scale_q16;
+    return 0;
+}
+
+/* Feed one block; returns true whenever a window completed and mag_mv[] was updated */
+bool goertzel_process(struct goertzel *g, const int16_t *in, size_t len)
+{
+    bool updated = false;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        int32_t x = in[i];
+        for (int k = 0; k < g->n_freqs; k++)
+        {
+            int32_t s0 = x + (int32_t)(((int64_t)g->coeff_q14[k] * g->s1[k]) >> 14) - g->s2[k];
+            g->s2[k] = g->s1[k];
+            g->s1[k] = s0;
+        }
+
+        if (++g->count < g->n)
+            continue;
+
+        for (int k = 0; k < g->n_freqs; k++)
+        {
+            int64_t s1 = g->s1[k], s2 = g->s2[k];
+            // |X|^2 = s1^2 + s2^2 - coeff*s1*s2, and a sine of amplitude A gives |X| = A*n/2;
+            // s1*s2 is split at bit 14 before the coefficient, whose product alone would overflow
+            int64_t p = s1 * s2;
+            int64_t cross = (p >> 14) * g->coeff_q14[k] + (((p & 0x3fff) * g->coeff_q14[k]) >> 14);
+            int64_t power = s1 * s1 + s2 * s2 - cross;
+            int64_t amp = 2 * (int64_t)isqrt64(power < 0 ? 0 : power) / g->n;
+            int64_t mv = (amp * g->scale_q16) >> 16;
+
+            g->mag_mv[k] = mv > UINT16_MAX ? UINT16_MAX : mv;
+            g->s1[k] = 0;
+            g->s2[k] = 0;
+        }
+        g->count = 0;
+        updated = true;
+    }
+    return updated;
+}
@@ -0,0 +1,26 @@
+#ifndef GOERTZEL_H
+#define GOERTZEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GOERTZEL_FREQS_MAX 8
+
+/* Goertzel detectors for a set of target frequencies, evaluated every n samples */
+struct goertzel
+{
+    int32_t coeff_q14[GOERTZEL_FREQS_MAX]; // 2*cos(2*pi*f/fs)
+    int32_t s1[GOERTZEL_FREQS_MAX];
+    int32_t s2[GOERTZEL_FREQS_MAX];
+    uint16_t mag_mv[GOERTZEL_FREQS_MAX]; // amplitude of the last completed window
+    int32_t scale_q16;                   // mV per input count
+    uint16_t n;
+    uint16_t count;
+    uint8_t n_freqs;
+};
+
+/* Functions */
+int goertzel_init(struct goertzel *g, const uint16_t *freqs_hz, int n_freqs, int fs_hz, int n, int32_t scale_q16);
+bool goertzel_process(struct goertzel *g, const int16_t *in, size_t len);
+
+#endif
@@ -0,0 +1,138 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "history.h"
+#include "imath.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(history, LOG_LEVEL_INF);
+
+/*
+ * Decimation pyramid: every closed one-second window is stored in the 1 s
+ * ring and folded into the open 10 s bucket; closing that bucket stores it
+ * and folds it into the open 1 min bucket. Each step is O(1).
+ */
+#define HISTORY_1S_LEN CONFIG_HISTORY_1S_LEN
+#define HISTORY_10S_LEN CONFIG_HISTORY_10S_LEN
+#define HISTORY_1MIN_LEN CONFIG_HISTORY_1MIN_LEN
+
+static const uint8_t fan_in[HISTORY_LEVELS] = {1, 10, 6}; // children per bucket
+static const uint16_t ring_len[HISTORY_LEVELS] = {HISTORY_1S_LEN, HISTORY_10S_LEN, HISTORY_1MIN_LEN};
+
+static struct history_bucket ring_1s[N_INPUT][HISTORY_1S_LEN];
+static struct history_bucket ring_10s[N_INPUT][HISTORY_10S_LEN];
+static struct history_bucket ring_1min[N_INPUT][HISTORY_1MIN_LEN];
+
+/* Bucket idx of the ring of one input at a level */
+static struct history_bucket *slot(int level, int ch, int idx)
+{
+    switch (level)
+    {
+    case HISTORY_1S:
+        return &ring_1s[ch][idx];
+    case HISTORY_10S:
+        return &ring_10s[ch][idx];
+    default:
+        return &ring_1min[ch][idx];
+    }
+}
+
+/* Open bucket being accumulated at each level above the first */
+struct history_acc
+{
+    int16_t min_mv;
+    int16_t max_mv;
+    int32_t sum_mean;
+    uint64_t sum_sq_rms; // parent RMS = sqrt(mean of child RMS^2)
+    uint8_t count;
+};
+
+static struct history_acc acc[HISTORY_LEVELS][N_INPUT];
+static uint16_t head[HISTORY_LEVELS][N_INPUT]; // next slot to write
+static uint16_t fill[HISTORY_LEVELS][N_INPUT];
+static struct k_spinlock lock;
+
+static void store(int level, int ch, const struct history_bucket *b);
+
+static void fold(int level, int ch, const struct history_bucket *b)
+{
+    struct history_acc *a = &acc[level][ch];
+
+    if (a->count == 0 || b->min_mv < a->min_mv)
+        a->min_mv = b->min_mv;
+    if (a->count == 0 || b->max_mv > a->max_mv)
+        a->max_mv = b->max_mv;
+    a->sum_mean += b->mean_mv;
+    a->sum_sq_rms += (uint32_t)b->rms_mv * b->rms_mv;
+
+    if (++a->count < fan_in[level])
+        return;
+
+    struct history_bucket out = {
+        .min_mv = a->min_mv,
+        .max_mv = a->max_mv,
+        .mean_mv = a->sum_mean / a->count,
+        .rms_mv = isqrt64(a->sum_sq_rms / a->count),
+    };
+    memset(a, 0, sizeof(*a));
+    store(level, ch, &out);
+}
+
+static void store(int level, int ch, const struct history_bucket *b)
+{
+    *slot(level, ch, head[level][ch]) = *b;
+    head[level][ch] = (head[level][ch] + 1) % ring_len[level];
+    if (fill[level][ch] < ring_len[level])
+        fill[level][ch]++;
+
+    if (level + 1 < HISTORY_LEVELS)
+        fold(level + 1, ch, b);
+}
+
+void history_push(int led, const struct rms_window_stats *st)
+{
+    const struct history_bucket b = {
+        .min_mv = st->min_mv,
+        .max_mv = st->max_mv,
+        .mean_mv = st->dc_mv,
+        .rms_mv = st->rms_mv,
+    };
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    store(HISTORY_1S, led - 1, &b);
+    k_spin_unlock(&lock, key);
+}
+
+/* Copy up to max buckets, newest first, skipping the start newest ones */
+int history_read(enum history_level level, int led, int start, struct history_bucket *out, int max)
+{
+    if (level >= HISTORY_LEVELS || led < 1 || led > N_INPUT || start < 0)
+        return -EINVAL;
+
+    int ch = led - 1;
+    int n = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    for (; n < max && start + n < fill[level][ch]; n++)
+    {
+        int idx = (head[level][ch] + ring_len[level] - 1 - start - n) % ring_len[level];
+        out[n] = *slot(level, ch, idx);
+    }
+    k_spin_unlock(&lock, key);
+
+    return n;
+}
+
+int history_count(enum history_level level)
+{
+    return level < HISTORY_LEVELS ? fill[level][0] : 0;
+}
+
+void history_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memset(acc, 0, sizeof(acc));
+    memset(head, 0, sizeof(head));
+    memset(fill, 0, sizeof(fill));
+    k_spin_unlock(&lock, key);
+    LOG_INF("History cleared");
+}
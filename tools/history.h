@@ -0,0 +1,30 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include "rms.h"
+
+enum history_level
+{
+    HISTORY_1S,
+    HISTORY_10S,
+    HISTORY_1MIN,
+    HISTORY_LEVELS,
+};
+
+/* Aggregate of one bucket (all values in mV) */
+struct history_bucket
+{
+    int16_t min_mv;
+    int16_t max_mv;
+    int16_t mean_mv;
+    uint16_t rms_mv;
+} __packed;
+
+/* Functions */
+void history_push(int led, const struct rms_window_stats *st);
+int history_read(enum history_level level, int led, int start, struct history_bucket *out, int max);
+int history_count(enum history_level level);
+void history_reset(void);
+
+#endif
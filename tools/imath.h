@@ -0,0 +1,9 @@
+#ifndef IMATH_H
+#define IMATH_H
+
+#include <stdint.h>
+
+/* Functions */
+uint32_t isqrt64(uint64_t x);
+
+#endif
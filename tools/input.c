@@ -0,0 +1,86 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "input.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(input, LOG_LEVEL_INF);
+
+/*
+ * The GPIO ISR only timestamps the edge and (re)arms a delayable work item.
+ * Every further bounce pushes the deadline out again, so the work handler
+ * runs once the pin has been stable for CONFIG_INPUT_DEBOUNCE_MS and sees
+ * the settled level. Actions therefore run once per press, in thread context.
+ */
+struct input_button
+{
+    struct gpio_dt_spec spec;
+    struct gpio_callback cb;
+    struct k_work_delayable debounce;
+    input_action_t action;
+    int64_t edge_ms;
+    bool pressed;
+};
+
+static struct input_button buttons[CONFIG_INPUT_MAX_BUTTONS];
+static int n_buttons;
+
+static K_THREAD_STACK_DEFINE(input_wq_stack, CONFIG_INPUT_WQ_STACK_SIZE);
+static struct k_work_q input_wq;
+
+static void on_edge(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    struct input_button *btn = CONTAINER_OF(cb, struct input_button, cb);
+
+    btn->edge_ms = k_uptime_get();
+    k_work_reschedule_for_queue(&input_wq, &btn->debounce, K_MSEC(CONFIG_INPUT_DEBOUNCE_MS));
+}
+
+static void on_settled(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct input_button *btn = CONTAINER_OF(dwork, struct input_button, debounce);
+
+    int level = gpio_pin_get_dt(&btn->spec);
+    if (level < 0)
+    {
+        LOG_ERR("Error reading button pin %d (err: %d)", btn->spec.pin, level);
+        return;
+    }
+
+    if (level && !btn->pressed)
+    {
+        btn->pressed = true;
+        LOG_DBG("Pin %d pressed (settled %lld ms after last edge)", btn->spec.pin, k_uptime_get() - btn->edge_ms);
+        btn->action();
+    }
+    else if (!level)
+    {
+        btn->pressed = false;
+    }
+}
+
+int input_add_button(const struct gpio_dt_spec *spec, input_action_t action)
+{
+    if (n_buttons >= CONFIG_INPUT_MAX_BUTTONS)
+        return -ENOMEM;
+
+    if (n_buttons == 0)
+    {
+        const struct k_work_queue_config cfg = {.name = "input_wq"};
+        k_work_queue_start(&input_wq, input_wq_stack, K_THREAD_STACK_SIZEOF(input_wq_stack),
+                           CONFIG_INPUT_WQ_PRIORITY, &cfg);
+    }
+
+    struct input_button *btn = &buttons[n_buttons++];
+    btn->spec = *spec;
+    btn->action = action;
+    k_work_init_delayable(&btn->debounce, on_settled);
+
+    // both edges, so releases are debounced too
+    int err = gpio_pin_interrupt_configure_dt(&btn->spec, GPIO_INT_EDGE_BOTH);
+    if (err)
+        return err;
+
+    gpio_init_callback(&btn->cb, on_edge, BIT(btn->spec.pin));
+    return gpio_add_callback(btn->spec.port, &btn->cb);
+}
@@ -0,0 +1,12 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <zephyr/drivers/gpio.h>
+
+/* Action run in the input work queue thread once a press has settled */
+typedef void (*input_action_t)(void);
+
+/* Functions */
+int input_add_button(const struct gpio_dt_spec *spec, input_action_t action);
+
+#endif
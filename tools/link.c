@@ -0,0 +1,114 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "link.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(link, LOG_LEVEL_INF);
+
+struct link
+{
+    struct bt_conn *conn;
+    struct k_work_delayable work;
+    bool streaming;
+    int64_t last_activity_ms;
+    enum link_profile requested;
+    uint16_t interval; // as reported by the controller, 1.25 ms units
+    uint16_t latency;
+};
+
+static struct link links[CONFIG_BT_MAX_CONN];
+
+static const struct bt_le_conn_param profile_params[] = {
+    [LINK_PROFILE_FAST] = BT_LE_CONN_PARAM_INIT(CONFIG_LINK_FAST_INTERVAL_MIN, CONFIG_LINK_FAST_INTERVAL_MAX,
+                                           0, CONFIG_LINK_SUPERVISION_TIMEOUT),
+    [LINK_PROFILE_IDLE] = BT_LE_CONN_PARAM_INIT(CONFIG_LINK_IDLE_INTERVAL_MIN, CONFIG_LINK_IDLE_INTERVAL_MAX,
+                                           CONFIG_LINK_IDLE_LATENCY, CONFIG_LINK_SUPERVISION_TIMEOUT),
+};
+
+/* Policy evaluation; all decisions run here, in the system work queue */
+static void link_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct link *l = CONTAINER_OF(dwork, struct link, work);
+
+    if (l->conn == NULL)
+        return;
+
+    int64_t idle_in = l->last_activity_ms + CONFIG_LINK_IDLE_TIMEOUT_MS - k_uptime_get();
+    enum link_profile wanted = (l->streaming || idle_in > 0) ? LINK_PROFILE_FAST : LINK_PROFILE_IDLE;
+
+    // come back when the burst of activity has timed out
+    if (!l->streaming && idle_in > 0)
+        k_work_reschedule(dwork, K_MSEC(idle_in));
+
+    if (wanted == l->requested)
+        return;
+
+    int err = bt_conn_le_param_update(l->conn, &profile_params[wanted]);
+    if (err)
+    {
+        LOG_WRN("Connection parameter update failed (err: %d)", err);
+        return;
+    }
+    l->requested = wanted;
+    LOG_INF("Requested %s connection parameters", wanted == LINK_PROFILE_FAST ? "fast" : "idle");
+}
+
+void link_connected(struct bt_conn *conn)
+{
+    struct link *l = &links[bt_conn_index(conn)];
+
+    l->conn = bt_conn_ref(conn);
+    l->streaming = false;
+    l->requested = LINK_PROFILE_NONE;
+    // service discovery follows the connection; treat it as activity
+    l->last_activity_ms = k_uptime_get();
+    k_work_init_delayable(&l->work, link_work_handler);
+    k_work_schedule(&l->work, K_NO_WAIT);
+}
+
+void link_disconnected(struct bt_conn *conn)
+{
+    struct link *l = &links[bt_conn_index(conn)];
+
+    k_work_cancel_delayable(&l->work);
+    if (l->conn)
+    {
+        bt_conn_unref(l->conn);
+        l->conn = NULL;
+    }
+}
+
+void link_set_streaming(struct bt_conn *conn, bool streaming)
+{
+    struct link *l = &links[bt_conn_index(conn)];
+
+    l->streaming = streaming;
+    l->last_activity_ms = k_uptime_get();
+    if (l->conn)
+        k_work_reschedule(&l->work, K_NO_WAIT);
+}
+
+void link_activity(struct bt_conn *conn)
+{
+    struct link *l = &links[bt_conn_index(conn)];
+
+    l->last_activity_ms = k_uptime_get();
+    if (l->conn && l->requested != LINK_PROFILE_FAST)
+        k_work_reschedule(&l->work, K_NO_WAIT);
+}
+
+void link_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    struct link *l = &links[bt_conn_index(conn)];
+
+    l->interval = interval;
+    l->latency = latency;
+    LOG_INF("Connection parameters: interval %d.%02d ms, latency %d, timeout %d ms",
+            interval * 5 / 4, (interval * 125) % 100, latency, timeout * 10);
+
+    // the central has the final say; note it but don't ask again until the policy changes
+    const struct bt_le_conn_param *p = l->requested != LINK_PROFILE_NONE ? &profile_params[l->requested] : NULL;
+    if (p && (interval < p->interval_min || interval > p->interval_max))
+        LOG_WRN("Central chose an interval outside the requested range");
+}
@@ -0,0 +1,26 @@
+#ifndef LINK_H
+#define LINK_H
+
+#include <zephyr/bluetooth/conn.h>
+#include <stdbool.h>
+
+/*
+ * Connection parameter policy. A link runs on short intervals with no
+ * peripheral latency while it streams or has seen a command within
+ * CONFIG_LINK_IDLE_TIMEOUT_MS, and on long intervals with latency otherwise.
+ */
+enum link_profile
+{
+    LINK_PROFILE_NONE,
+    LINK_PROFILE_FAST,
+    LINK_PROFILE_IDLE,
+};
+
+/* Functions */
+void link_connected(struct bt_conn *conn);
+void link_disconnected(struct bt_conn *conn);
+void link_set_streaming(struct bt_conn *conn, bool streaming);
+void link_activity(struct bt_conn *conn);
+void link_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout);
+
+#endif
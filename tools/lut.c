@@ -0,0 +1,25 @@
+#include "lut.h"
+
+/* Gamma-corrected duty (0..LUT_FULL_SCALE) for val clamped to [val_min, val_max] */
+uint16_t lut_gamma(int val, int val_min, int val_max)
+{
+    if (val <= val_min)
+        return lut_gamma_table[0];
+    if (val >= val_max)
+        return lut_gamma_table[LUT_GAMMA_STEPS - 1];
+
+    return lut_gamma_table[(val - val_min) * (LUT_GAMMA_STEPS - 1) / (val_max - val_min)];
+}
+
+/* Battery state of charge (%) from the voltage at the ADC pin */
+uint8_t lut_batt_percent(int adc_mv)
+{
+    int idx = (adc_mv - LUT_BATT_ADC_MV_MIN) / LUT_BATT_ADC_MV_STEP;
+
+    if (idx < 0)
+        idx = 0;
+    else if (idx >= LUT_BATT_STEPS)
+        idx = LUT_BATT_STEPS - 1;
+
+    return lut_batt_table[idx];
+}
@@ -0,0 +1,11 @@
+#ifndef LUT_H
+#define LUT_H
+
+#include <stdint.h>
+#include "lut_tables.h"
+
+/* Functions */
+uint16_t lut_gamma(int val, int val_min, int val_max);
+uint8_t lut_batt_percent(int adc_mv);
+
+#endif
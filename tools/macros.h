@@ -1,6 +1,9 @@
 #ifndef MACROS_H
 #define MACROS_H
 
+#include <zephyr/devicetree.h>
+#include <zephyr/sys/time_units.h>
+
 /* States */
 #define STATE_DEFAULT 0
 #define STATE_VBUS_DETECTED -1
@@ -10,28 +13,26 @@
 #define T_ADC_READ_US 150
 #define T_DATA 5000
 #define T_DATA_S 5
-#define N_VOLTAGE T_DATA * 1000 / T_ADC_READ_US
-#define N_INPUT 2
+#define N_VOLTAGE (T_DATA * 1000 / T_ADC_READ_US)
+// the frame timer runs in whole kernel ticks, so the real rate is that of the rounded-up period
+#define FRAME_TICKS k_us_to_ticks_ceil32(T_ADC_READ_US)
+#define FRAME_FS_HZ ((CONFIG_SYS_CLOCK_TICKS_PER_SEC + FRAME_TICKS / 2) / FRAME_TICKS)
+// signal inputs are the io-channels of zephyr,user; per-input settings sit next to them
+#define ZEPHYR_USER DT_PATH(zephyr_user)
+#define N_INPUT DT_PROP_LEN(ZEPHYR_USER, io_channels)
 
 /* Bluetooth */
-#define N_BLE 10
+#define N_BLE (N_INPUT * T_DATA_S)
+#define N_SPECTRUM (N_INPUT * N_GOERTZEL)
 
-/* Battery */
-#define T_BAT_CHECK_S 5
-#define T_BAT_CHECK ((T_BAT_CHECK_S * 1000) * (1000 / T_ADC_READ_US))
-#define NOMINAL_BATT_MV 3700
-#define BATT_FACTOR 0.48648649
+/* Spectrum (Goertzel detectors per input) */
+#define N_GOERTZEL 4
+#define GOERTZEL_FREQS_HZ {50, 60, 100, 120}
 
 /* VBUS */
 #define T_VBUS_LED 500
 #define T_VBUS 500
 
-/* Input Voltages */
-#define VPP_MIN1 5
-#define VPP_MIN2 10
-#define VPP_MAX1 50
-#define VPP_MAX2 150
-
 /* Miscellaneous */
 #define nop
 
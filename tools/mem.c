@@ -0,0 +1,42 @@
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "mem.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(mem, LOG_LEVEL_INF);
+
+struct walk
+{
+    struct mem_thread_usage *out;
+    int max;
+    int n;
+};
+
+static void add_thread(const struct k_thread *thread, void *user_data)
+{
+    struct walk *w = user_data;
+    size_t unused;
+
+    if (w->n >= w->max)
+        return;
+
+    struct mem_thread_usage *u = &w->out[w->n++];
+    const char *name = k_thread_name_get((k_tid_t)thread);
+
+    strncpy(u->name, name ? name : "", sizeof(u->name));
+    if (k_thread_stack_space_get(thread, &unused))
+        unused = 0;
+    u->size = MIN(thread->stack_info.size, UINT16_MAX);
+    u->unused = MIN(unused, UINT16_MAX);
+    LOG_DBG("%.8s: %d of %d bytes used", u->name, u->size - u->unused, u->size);
+}
+
+/* Same data as the thread analyzer, for every thread up to max; returns the number filled in */
+int mem_thread_usage(struct mem_thread_usage *out, int max)
+{
+    struct walk w = {.out = out, .max = max};
+
+    // scanning a stack for the paint pattern takes a while, so threads are not locked out meanwhile
+    k_thread_foreach_unlocked(add_thread, &w);
+    return w.n;
+}
@@ -0,0 +1,25 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <zephyr/kernel.h>
+
+/* Stack usage of one thread; stacks are painted at creation (CONFIG_INIT_STACKS) */
+struct mem_thread_usage
+{
+    char name[8]; // truncated, not terminated when 8 long
+    uint16_t size;
+    uint16_t unused; // never touched since boot, so size - unused is the high-water mark
+};
+
+#if defined(CONFIG_MEM_REPORT)
+int mem_thread_usage(struct mem_thread_usage *out, int max);
+#else
+static inline int mem_thread_usage(struct mem_thread_usage *out, int max)
+{
+    ARG_UNUSED(out);
+    ARG_UNUSED(max);
+    return -ENOTSUP;
+}
+#endif
+
+#endif
@@ -0,0 +1,241 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "pipeline.h"
+#include "filter.h"
+#include "goertzel.h"
+#include "rms.h"
+#include "event.h"
+#include "history.h"
+#include "lut.h"
+#include "bench.h"
+#include "setup.h"
+#include "state.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(pipeline, LOG_LEVEL_INF);
+
+K_MEM_SLAB_DEFINE_STATIC(block_slab, sizeof(struct sample_block), CONFIG_PIPELINE_BLOCKS, 4);
+K_MSGQ_DEFINE(dsp_q, sizeof(struct sample_block *), CONFIG_PIPELINE_BLOCKS, 4);
+K_MSGQ_DEFINE(out_q, sizeof(struct sample_block *), CONFIG_PIPELINE_BLOCKS, 4);
+
+/* Per-stage processing time */
+BENCH_DEFINE(stage_dsp);
+BENCH_DEFINE(stage_out);
+BENCH_DEFINE(rms_frames);
+
+/* Per-input settings from zephyr,user */
+const uint16_t input_config[INPUT_CONFIG_CELLS * N_INPUT] = {
+    DT_FOREACH_PROP_ELEM_SEP(ZEPHYR_USER, input_config, DT_PROP_BY_IDX, (,))};
+BUILD_ASSERT(DT_PROP_LEN(ZEPHYR_USER, input_config) == INPUT_CONFIG_CELLS * N_INPUT &&
+             DT_PROP_LEN(ZEPHYR_USER, pwms) == N_INPUT,
+             "zephyr,user needs a pwms entry and an input-config triplet per io-channel");
+
+static struct sample_block *filling;
+static uint32_t seq;
+static atomic_t overruns;
+static atomic_t reset_pending; // applied by the DSP stage, which owns the RMS engine and history
+static uint8_t blocks_max_used; // high-water mark of the slab, written by acquisition only
+
+/* Stored counts of the block in process, interleaved like the FIFO (DSP stage only) */
+static rms_frame_t frames[CONFIG_BLOCK_SIZE];
+
+/* Spectrum magnitudes (mV) per input and target frequency (DSP stage only) */
+static uint16_t spectrum[N_SPECTRUM];
+
+/* Published by the DSP stage after every block */
+static struct pipeline_results results;
+static struct k_spinlock results_lock;
+
+static struct filter filters[N_INPUT];
+static struct goertzel detectors[N_INPUT];
+static struct pwm_dt_spec out_pwms[N_INPUT];
+
+/*
+ * A replay must not lose data, so acquisition waits for a free block there;
+ * live acquisition never blocks and drops the frame instead.
+ */
+#define ACQ_TIMEOUT (IS_ENABLED(CONFIG_REPLAY) ? K_FOREVER : K_NO_WAIT)
+
+int pipeline_init(const struct pwm_dt_spec *pwms, const int32_t *scale_q16)
+{
+    const int fs_hz = FRAME_FS_HZ;
+    int ret = 0;
+
+    LOG_INF("Sampling at %d Hz (%d ticks per frame)", fs_hz, FRAME_TICKS);
+    memcpy(out_pwms, pwms, sizeof(out_pwms));
+    for (int ch = 0; ch < N_INPUT; ch++)
+    {
+        filter_init(&filters[ch]);
+        if (CONFIG_FILTER_NOTCH_HZ > 0)
+            ret += filter_add_notch(&filters[ch], CONFIG_FILTER_NOTCH_HZ, CONFIG_FILTER_NOTCH_Q_X10, fs_hz);
+        if (CONFIG_FILTER_BANDPASS_HZ > 0)
+            ret += filter_add_bandpass(&filters[ch], CONFIG_FILTER_BANDPASS_HZ, CONFIG_FILTER_BANDPASS_Q_X10, fs_hz);
+        if (IS_ENABLED(CONFIG_GOERTZEL))
+        {
+            const uint16_t freqs[N_GOERTZEL] = GOERTZEL_FREQS_HZ;
+            ret += goertzel_init(&detectors[ch], freqs, N_GOERTZEL, fs_hz, CONFIG_GOERTZEL_N, scale_q16[ch]);
+        }
+    }
+    return ret;
+}
+
+/* Acquisition stage: called from the sampling loop with the raw counts of every input */
+void pipeline_push(const int16_t *frame)
+{
+    struct sample_block *blk = filling;
+
+    if (blk == NULL)
+    {
+        if (k_mem_slab_alloc(&block_slab, (void **)&blk, ACQ_TIMEOUT))
+        {
+            atomic_inc(&overruns);
+            return;
+        }
+        blk->len = 0;
+        blk->seq = seq++;
+        filling = blk;
+        blocks_max_used = MAX(blocks_max_used, CONFIG_PIPELINE_BLOCKS - k_mem_slab_num_free_get(&block_slab));
+    }
+
+    for (int ch = 0; ch < N_INPUT; ch++)
+        blk->raw[ch][blk->len] = frame[ch];
+    if (++blk->len < CONFIG_BLOCK_SIZE)
+        return;
+
+    filling = NULL;
+    if (k_msgq_put(&dsp_q, &blk, ACQ_TIMEOUT))
+    {
+        atomic_inc(&overruns);
+        k_mem_slab_free(&block_slab, blk);
+    }
+}
+
+/* DSP stage: spectrum on the raw block, then filter, RMS windows and event triggers */
+static void dsp_stage(void *p1, void *p2, void *p3)
+{
+    struct sample_block *blk;
+
+    while (k_msgq_get(&dsp_q, &blk, K_FOREVER) == 0)
+    {
+        uint32_t start = bench_start();
+
+        if (atomic_clear(&reset_pending))
+        {
+            rms_reset();
+            history_reset();
+        }
+
+        for (int ch = 0; ch < N_INPUT; ch++)
+        {
+            if (IS_ENABLED(CONFIG_GOERTZEL) && goertzel_process(&detectors[ch], blk->raw[ch], blk->len))
+                memcpy(&spectrum[ch * N_GOERTZEL], detectors[ch].mag_mv, N_GOERTZEL * sizeof(uint16_t));
+            filter_process(&filters[ch], blk->raw[ch], blk->out[ch], blk->len);
+
+            // saturate rather than wrap when an input overdrives its raw-shift
+            int shift = input_raw_shift(ch);
+            for (int i = 0; i < blk->len; i++)
+                rms_frame_set(&frames[i], ch, CLAMP(blk->out[ch][i] >> shift, RMS_SAMPLE_MIN, RMS_SAMPLE_MAX));
+        }
+
+        uint32_t rms_start = bench_start();
+        rms_add_frames(frames, blk->len);
+        bench_stop(&rms_frames, rms_start);
+
+        calculate_rms();
+        for (int led = 1; led <= N_INPUT; led++)
+            event_process_block(led, blk->len);
+
+        for (int ch = 0; ch < N_INPUT; ch++)
+        {
+            blk->vpp_mv[ch] = rms_last_window(ch + 1)->vpp_mv;
+            blk->rms_mv[ch] = rms_last_window(ch + 1)->rms_mv;
+        }
+        k_spinlock_key_t key = k_spin_lock(&results_lock);
+        for (int i = 0; i < N_BLE; i++)
+            results.rms_mv[i] = rms_window_mv(i);
+        memcpy(results.spectrum_mv, spectrum, sizeof(results.spectrum_mv));
+        for (int ch = 0; ch < N_INPUT; ch++)
+            results.stats[ch] = *rms_last_window(ch + 1);
+        k_spin_unlock(&results_lock, key);
+        bench_stop(&stage_dsp, start);
+
+        // the output stage always has room: it holds at most every block there is
+        k_msgq_put(&out_q, &blk, K_FOREVER);
+    }
+}
+
+/* Output stage: LED brightness from the latest window, then the block is released */
+static void out_stage(void *p1, void *p2, void *p3)
+{
+    struct sample_block *blk;
+
+    while (k_msgq_get(&out_q, &blk, K_FOREVER) == 0)
+    {
+        uint32_t start = bench_start();
+
+        for (int ch = 0; ch < N_INPUT; ch++)
+        {
+            const struct pwm_dt_spec *pwm = &out_pwms[ch];
+            int vpp_min = input_vpp_min_mv(ch);
+            int vpp_max = input_vpp_max_mv(ch);
+            int vpp = blk->vpp_mv[ch]; // measured, not vrms * sqrt(2)
+            uint16_t duty = lut_gamma(vpp, vpp_min, vpp_max);
+            uint32_t pulsewidth = (uint64_t)pwm->period * duty / LUT_FULL_SCALE;
+            LOG_DBG("LED%d\tpw=%d\tduty=%d\tvpp/vmax=%d/%d\trms=%d", ch + 1, pulsewidth, duty, vpp, vpp_max,
+                    blk->rms_mv[ch]);
+
+            // blocks still in flight when acquisition stops must not relight the LEDs
+            int ret = state_set_output(pwm, pulsewidth);
+            if (ret)
+                LOG_ERR("Error updating duty cycle of PWM channel %d", pwm->channel);
+        }
+
+        k_mem_slab_free(&block_slab, blk);
+        bench_stop(&stage_out, start);
+    }
+}
+
+K_THREAD_DEFINE(dsp_tid, CONFIG_PIPELINE_DSP_STACK_SIZE, dsp_stage, NULL, NULL, NULL,
+                CONFIG_PIPELINE_DSP_PRIORITY, 0, 0);
+K_THREAD_DEFINE(out_tid, CONFIG_PIPELINE_OUT_STACK_SIZE, out_stage, NULL, NULL, NULL,
+                CONFIG_PIPELINE_OUT_PRIORITY, 0, 0);
+
+void pipeline_results_get(struct pipeline_results *res)
+{
+    k_spinlock_key_t key = k_spin_lock(&results_lock);
+    *res = results;
+    k_spin_unlock(&results_lock, key);
+}
+
+/* Wait until every queued block has been through all stages (a partial block stays) */
+void pipeline_drain(void)
+{
+    int partial = filling != NULL;
+
+    while (k_mem_slab_num_free_get(&block_slab) + partial < CONFIG_PIPELINE_BLOCKS)
+        k_msleep(1);
+}
+
+uint32_t pipeline_overruns(void)
+{
+    return atomic_get(&overruns);
+}
+
+/* Frames the acquisition loop could not take in time, counted with the overruns */
+void pipeline_count_missed(int frames)
+{
+    atomic_add(&overruns, frames);
+}
+
+/* Clear the overrun count now, and the RMS windows and history before the next block */
+void pipeline_reset(void)
+{
+    atomic_clear(&overruns);
+    atomic_set(&reset_pending, 1);
+}
+
+int pipeline_blocks_max_used(void)
+{
+    return blocks_max_used;
+}
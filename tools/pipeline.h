@@ -0,0 +1,71 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/pwm.h>
+#include "macros.h"
+#include "rms.h"
+
+/*
+ * Sample processing pipeline. The acquisition loop fills blocks taken from a
+ * memory slab, one frame (every input) at a time; full blocks are passed by
+ * pointer through message queues to the DSP stage (spectrum, filter, RMS,
+ * events) and then to the output stage (PWM), which returns them to the slab.
+ * Each stage runs in its own thread at its own priority, so a slow stage only
+ * delays, not stalls, acquisition. Results travel with the block; the RMS
+ * engine state stays with the DSP stage, which publishes a copy for BLE,
+ * commands and the broadcast (pipeline_results_get()).
+ */
+struct sample_block
+{
+    uint16_t len; // frames
+    uint32_t seq;
+    int16_t raw[N_INPUT][CONFIG_BLOCK_SIZE]; // per input, for the filters
+    int16_t out[N_INPUT][CONFIG_BLOCK_SIZE]; // filtered
+    uint16_t vpp_mv[N_INPUT];                // last closed window when the block left the DSP stage
+    uint16_t rms_mv[N_INPUT];
+};
+
+/* Latest DSP results, copied out under a lock */
+struct pipeline_results
+{
+    uint16_t rms_mv[N_BLE];           // sliding windows, as rms_window_mv()
+    uint16_t spectrum_mv[N_SPECTRUM]; // per input and target frequency
+    struct rms_window_stats stats[N_INPUT];
+};
+
+/*
+ * Per-input settings, zephyr,user input-config = <raw-shift vpp-min-mv
+ * vpp-max-mv> per input. One property of triplets rather than one property
+ * per setting: with a single input a one-cell property is typed as an int,
+ * not an array, and could not be iterated.
+ */
+#define INPUT_CONFIG_CELLS 3
+extern const uint16_t input_config[INPUT_CONFIG_CELLS * N_INPUT];
+
+static inline int input_raw_shift(int ch)
+{
+    return input_config[INPUT_CONFIG_CELLS * ch];
+}
+
+static inline int input_vpp_min_mv(int ch)
+{
+    return input_config[INPUT_CONFIG_CELLS * ch + 1];
+}
+
+static inline int input_vpp_max_mv(int ch)
+{
+    return input_config[INPUT_CONFIG_CELLS * ch + 2];
+}
+
+/* Functions */
+int pipeline_init(const struct pwm_dt_spec *pwms, const int32_t *scale_q16);
+void pipeline_push(const int16_t *frame);
+void pipeline_drain(void);
+uint32_t pipeline_overruns(void);
+void pipeline_count_missed(int frames);
+void pipeline_reset(void);
+int pipeline_blocks_max_used(void);
+void pipeline_results_get(struct pipeline_results *res);
+
+#endif
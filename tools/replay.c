@@ -0,0 +1,114 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "replay.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(replay, LOG_LEVEL_INF);
+
+#define FRAME_BYTES (N_INPUT * sizeof(int16_t))
+
+static const uint8_t *samples;
+static size_t n_frames;
+static size_t pos; // next frame
+static uint32_t windows;
+static struct timespec t_start;
+
+static double elapsed_s(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - t_start.tv_sec) + (now.tv_nsec - t_start.tv_nsec) * 1e-9;
+}
+
+static int replay_open(void)
+{
+    const char *path = getenv("REPLAY_FILE");
+    if (path == NULL)
+        path = CONFIG_REPLAY_FILE;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERR("Cannot open %s", path);
+        return -ENOENT;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < FRAME_BYTES)
+    {
+        close(fd);
+        return -EINVAL;
+    }
+
+    // read-only shared mapping; pages are faulted in as the replay advances
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -ENOMEM;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    samples = map;
+    n_frames = st.st_size / FRAME_BYTES;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+
+    LOG_INF("Replaying %s: %zu frames of %d inputs at %d Hz", path, n_frames, N_INPUT, FRAME_FS_HZ);
+    printk("out,t_ms,input,rms_mv,dc_mv,min_mv,max_mv,vpp_mv,crest_x100\n");
+    return 0;
+}
+
+static int replay_read(int16_t frame[N_INPUT])
+{
+    // a file that could not be mapped ends the run like an exhausted one
+    if (samples == NULL || pos >= n_frames)
+        return -ENODATA;
+
+    const uint8_t *p = &samples[pos++ * FRAME_BYTES];
+    for (int ch = 0; ch < N_INPUT; ch++)
+        frame[ch] = (int16_t)sys_get_le16(&p[ch * sizeof(int16_t)]);
+    return 0;
+}
+
+void replay_output(int led, const struct rms_window_stats *st)
+{
+    // recorded time, from the frame position and the frame rate
+    uint64_t t_ms = (uint64_t)pos * 1000 / FRAME_FS_HZ;
+
+    windows++;
+    printk("out,%llu,%d,%u,%d,%d,%d,%u,%u\n", t_ms, led, st->rms_mv, st->dc_mv, st->min_mv,
+           st->max_mv, st->vpp_mv, st->crest_x100);
+}
+
+static void replay_finish(void)
+{
+    double wall = elapsed_s();
+    double recorded = (double)n_frames / FRAME_FS_HZ;
+    uint64_t total = (uint64_t)n_frames * N_INPUT;
+
+    printk("replay: %llu samples (%.1f s recorded) in %.3f s, %.0f samples/s, %.0fx real time, %u windows\n",
+           total, recorded, wall, wall > 0 ? total / wall : 0, wall > 0 ? recorded / wall : 0, windows);
+
+    // ends the native_sim process, so a replay can be scripted
+    exit(EXIT_SUCCESS);
+}
+
+static const struct frame_source replay_source = {
+    .name = "replay",
+    .open = replay_open,
+    .read = replay_read,
+    .finish = replay_finish,
+    .paced = false,
+};
+
+const struct frame_source *replay_source_get(void)
+{
+    return &replay_source;
+}
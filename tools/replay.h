@@ -0,0 +1,31 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <zephyr/kernel.h>
+#include "rms.h"
+#include "source.h"
+
+/*
+ * Recorded-frame source for native_sim builds. The file given by the
+ * REPLAY_FILE environment variable, or CONFIG_REPLAY_FILE, is memory-mapped
+ * and holds frames of N_INPUT little-endian int16 raw counts, in the order
+ * of the zephyr,user io-channels. It is fed through the signal path without
+ * waiting for the frame timer; each closed RMS window is printed as one CSV
+ * line and the throughput is reported at the end.
+ */
+#if defined(CONFIG_REPLAY)
+const struct frame_source *replay_source_get(void);
+void replay_output(int led, const struct rms_window_stats *st);
+#else
+static inline const struct frame_source *replay_source_get(void)
+{
+    return NULL;
+}
+static inline void replay_output(int led, const struct rms_window_stats *st)
+{
+    ARG_UNUSED(led);
+    ARG_UNUSED(st);
+}
+#endif
+
+#endif
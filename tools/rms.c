@@ -1,57 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
 #include "rms.h"
+#include "history.h"
+#include "imath.h"
+#include "replay.h"
 
 /* Logger */
 LOG_MODULE_REGISTER(rms, LOG_LEVEL_INF);
 
-void add_v(int led, int val)
+/* Voltages */
+static rms_frame_t vq[N_VOLTAGE]; // FIFO of frames: vq[(vq_head+i) % N_VOLTAGE], see rms_frame_get()
+static int vq_head;
+static uint16_t vble[N_BLE];
+static uint64_t sqsum[N_BLE];
+static int64_t vsum[N_BLE];
+static int16_t vdc[N_BLE]; // per-window DC (mean) in mV
+static struct rms_window_stats vstats[N_INPUT]; // min/max/Vpp/crest of the last full second
+
+/* Gain (mV per stored count, Q16) and offset applied once to each final RMS value */
+static int32_t cal_scale_q16[N_INPUT] = {[0 ... N_INPUT - 1] = 1 << 16};
+static int32_t cal_offset_mv[N_INPUT];
+
+/* Min/max of the window currently being filled, closed every N_VOLTAGE / T_DATA_S samples */
+static int16_t win_min[N_INPUT];
+static int16_t win_max[N_INPUT];
+static int win_count; // frames, the same for every input
+
+static int32_t counts_to_mv(int ch, int64_t counts)
+{
+    return (counts * cal_scale_q16[ch]) >> 16;
+}
+
+/* Samples in window j of a channel; N_VOLTAGE need not divide evenly into T_DATA_S windows */
+int rms_window_len(int j)
+{
+    return (j + 1) * N_VOLTAGE / T_DATA_S - j * N_VOLTAGE / T_DATA_S;
+}
+
+/* RMS (mV, calibrated) and mean (mV) of window i from its running sums */
+static uint16_t window_rms(int i, int16_t *dc_mv)
+{
+    const int64_t n = rms_window_len(i % T_DATA_S);
+    int ch = i / T_DATA_S;
+
+    // n * sum(x^2) - (sum x)^2 = n^2 * variance, exact in integers
+    uint64_t ms_n2 = n * sqsum[i];
+    if (IS_ENABLED(CONFIG_RMS_AC_COUPLED))
+        ms_n2 -= vsum[i] * vsum[i];
+    int64_t rms_n = isqrt64(ms_n2); // n * rms in counts
+
+    int64_t mv = ((rms_n * cal_scale_q16[ch]) / n >> 16) + cal_offset_mv[ch];
+    *dc_mv = vsum[i] * cal_scale_q16[ch] / (n << 16);
+    return mv < 0 ? 0 : (mv > UINT16_MAX ? UINT16_MAX : mv);
+}
+
+/* The newest sliding window covers exactly the samples of the window just closed */
+static void close_window(int ch)
 {
-    int i0 = (led == 1 ? i1_1 : i1_2) % (N_VOLTAGE);
-    int imin = led == 1 ? 0 : T_DATA_S;
-    int imax = imin + T_DATA_S;
+    struct rms_window_stats *st = &vstats[ch];
 
-    // compute squared sums for each second
-    for (int i = imin; i < imax; i++)
+    st->rms_mv = window_rms(ch * T_DATA_S + T_DATA_S - 1, &st->dc_mv);
+    st->min_mv = counts_to_mv(ch, win_min[ch]);
+    st->max_mv = counts_to_mv(ch, win_max[ch]);
+    st->vpp_mv = st->max_mv - st->min_mv;
+
+    int ref = IS_ENABLED(CONFIG_RMS_AC_COUPLED) ? st->dc_mv : 0;
+    int peak = MAX(abs(st->max_mv - ref), abs(st->min_mv - ref));
+    st->crest_x100 = st->rms_mv ? MIN(peak * 100 / st->rms_mv, UINT16_MAX) : 0;
+
+    LOG_DBG("ch%d: min=%d max=%d vpp=%d rms=%d dc=%d crest=%d/100", ch + 1, st->min_mv, st->max_mv,
+            st->vpp_mv, st->rms_mv, st->dc_mv, st->crest_x100);
+
+    history_push(ch + 1, st);
+    replay_output(ch + 1, st);
+}
+
+void rms_reset(void)
+{
+    memset(vq, 0, sizeof(vq));
+    vq_head = 0;
+    memset(sqsum, 0, sizeof(sqsum));
+    memset(vsum, 0, sizeof(vsum));
+    memset(vble, 0, sizeof(vble));
+    memset(vdc, 0, sizeof(vdc));
+    memset(vstats, 0, sizeof(vstats));
+    win_count = 0;
+}
+
+void rms_set_calibration(int led, int32_t scale_q16, int32_t offset_mv)
+{
+    cal_scale_q16[led - 1] = scale_q16;
+    cal_offset_mv[led - 1] = offset_mv;
+}
+
+/*
+ * Slide every window over c frames that need no split: none of the runs below
+ * wraps the FIFO and no window closes inside. Window j loses the frames at
+ * offset j of the FIFO and takes over those at offset j + 1, which the newest
+ * window takes from the block. Each run is walked linearly, all inputs of a
+ * frame at once.
+ */
+static void slide_frames(const rms_frame_t *frames, const int *start, int c)
+{
+    for (int j = 0; j < T_DATA_S; j++)
     {
-        int i1 = (i0 + (i * N_VOLTAGE / T_DATA_S)) % (N_VOLTAGE);
-        if(led==1) LOG_DBG("1.ss[%d]=%f\ti0=%d\ti1=%d", i, sqsum[i],i0,i1);
-        sqsum[i] -= led == 1 ? vq1[i1] * vq1[i1] : vq2[i1] * vq2[i1];
-        if (led==1) LOG_DBG("2.ss[%d]-=vq1[i1]^2=\t%d^2=%f",i,vq1[i1],sqsum[i]);
-
-        if (i < imax - 1) {
-            int i2 = (i0 + ((i + 1) * N_VOLTAGE / T_DATA_S)) % (N_VOLTAGE);
-            sqsum[i] += led == 1 ? vq1[i2] * vq1[i2] : vq2[i2] * vq2[i2];
-            if(led==1) LOG_DBG("3.ss[%d]+=vq1[i2]^2=\t%d^2=%f",i,vq1[i2],sqsum[i]);
+        const rms_frame_t *out = &vq[start[j]];
+        const rms_frame_t *in = j < T_DATA_S - 1 ? &vq[start[j + 1]] : frames;
+        int64_t dss[N_INPUT] = {0};
+        int32_t ds[N_INPUT] = {0};
+
+        for (int k = 0; k < c; k++)
+        {
+            for (int ch = 0; ch < N_INPUT; ch++)
+            {
+                int o = rms_frame_get(&out[k], ch);
+                int v = rms_frame_get(&in[k], ch);
+                dss[ch] += v * v - o * o;
+                ds[ch] += v - o;
+            }
         }
-        else {
-            sqsum[i] += val * val;
-            if(led==1) LOG_DBG("3.ss[%d]+=val^2=\t%d^2=%f",i,val,sqsum[i]);
+        for (int ch = 0; ch < N_INPUT; ch++)
+        {
+            sqsum[ch * T_DATA_S + j] += dss[ch];
+            vsum[ch * T_DATA_S + j] += ds[ch];
         }
     }
 
-    // add new value (FIFO)
-    if (led == 1)
+    // track extremes of the window being filled
+    for (int k = 0; k < c; k++)
     {
-        vq1[i0] = val;
-        i1_1++;
-        i1_1 %= (N_VOLTAGE);
+        for (int ch = 0; ch < N_INPUT; ch++)
+        {
+            int v = rms_frame_get(&frames[k], ch);
+            win_min[ch] = MIN(win_min[ch], v);
+            win_max[ch] = MAX(win_max[ch], v);
+        }
     }
-    else if (led == 2)
+
+    // add new frames (FIFO)
+    memcpy(&vq[start[0]], frames, c * sizeof(frames[0]));
+}
+
+void rms_add_frames(const rms_frame_t *frames, int n)
+{
+    while (n > 0)
     {
-        vq2[i0] = val;
-        i1_2++;
-        i1_2 %= (N_VOLTAGE);
-    }
+        int start[T_DATA_S];
+        int c = MIN(n, N_VOLTAGE / T_DATA_S - win_count);
+
+        if (win_count == 0)
+        {
+            for (int ch = 0; ch < N_INPUT; ch++)
+            {
+                win_min[ch] = RMS_SAMPLE_MAX;
+                win_max[ch] = RMS_SAMPLE_MIN;
+            }
+        }
 
-    calculate_rms();
+        // split where any run reaches the end of the FIFO
+        for (int j = 0; j < T_DATA_S; j++)
+        {
+            start[j] = (vq_head + j * N_VOLTAGE / T_DATA_S) % N_VOLTAGE;
+            c = MIN(c, N_VOLTAGE - start[j]);
+        }
+
+        slide_frames(frames, start, c);
+        frames += c;
+        n -= c;
+        vq_head = (vq_head + c) % N_VOLTAGE;
+
+        win_count += c;
+        if (win_count == N_VOLTAGE / T_DATA_S)
+        {
+            for (int ch = 0; ch < N_INPUT; ch++)
+                close_window(ch);
+            win_count = 0;
+        }
+    }
 }
 
 void calculate_rms(void)
 {
     for (int i = 0; i < N_BLE; i++)
     {
-        LOG_DBG("ss[%d] = %f", i, sqsum[i]);
-        LOG_DBG("vrms = %f", sqrt(sqsum[i] / (N_VOLTAGE / T_DATA_S)));
-        vble[i] = (uint16_t)sqrt(sqsum[i] / (N_VOLTAGE / T_DATA_S));
-        LOG_DBG("vble[%d] = %d", i, vble[i]);
+        vble[i] = window_rms(i, &vdc[i]);
+        LOG_DBG("ss[%d] = %llu\ts = %lld\tvble = %d\tvdc = %d", i, sqsum[i], vsum[i], vble[i], vdc[i]);
     }
 }
+
+int rms_fifo_head(void)
+{
+    return vq_head;
+}
+
+int rms_fifo_sample(int led, int pos)
+{
+    pos %= N_VOLTAGE;
+    return rms_frame_get(&vq[pos < 0 ? pos + N_VOLTAGE : pos], led - 1);
+}
+
+uint16_t rms_window_mv(int i)
+{
+    return vble[i];
+}
+
+void rms_window_sums(int i, int64_t *sum, uint64_t *sumsq)
+{
+    *sum = vsum[i];
+    *sumsq = sqsum[i];
+}
+
+const struct rms_window_stats *rms_last_window(int led)
+{
+    return &vstats[led - 1];
+}
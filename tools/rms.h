@@ -1,16 +1,79 @@
+#ifndef RMS_H
+#define RMS_H
+
 #include <zephyr/logging/log.h>
 #include <stdint.h>
 #include <math.h>
 #include "macros.h"
 
-/* Voltages */
-extern int8_t vq1[N_VOLTAGE];
-extern int16_t vq2[N_VOLTAGE];
-extern uint16_t vble[N_BLE];
-extern int i1_1;
-extern int i1_2;
-extern float sqsum[N_BLE];
+/*
+ * One FIFO frame: a sample of every input, raw counts >> raw-shift of the
+ * input. Samples are 12-bit by default, packed as a signed high byte per
+ * input plus a low nibble shared by pairs of inputs (3 bytes for 2 inputs).
+ */
+#if defined(CONFIG_RMS_SAMPLE_16BIT)
+typedef struct
+{
+    int16_t s[N_INPUT];
+} rms_frame_t;
+#define RMS_SAMPLE_MIN INT16_MIN
+#define RMS_SAMPLE_MAX INT16_MAX
+
+static inline int rms_frame_get(const rms_frame_t *f, int ch)
+{
+    return f->s[ch];
+}
+
+static inline void rms_frame_set(rms_frame_t *f, int ch, int v)
+{
+    f->s[ch] = v;
+}
+#else
+typedef struct
+{
+    int8_t hi[N_INPUT];             // sample >> 4
+    uint8_t lo[(N_INPUT + 1) / 2]; // sample & 0xf, two inputs per byte
+} rms_frame_t;
+#define RMS_SAMPLE_MIN (-2048)
+#define RMS_SAMPLE_MAX 2047
+
+static inline int rms_frame_get(const rms_frame_t *f, int ch)
+{
+    return f->hi[ch] * 16 + ((f->lo[ch / 2] >> (ch % 2 * 4)) & 0xf);
+}
+
+static inline void rms_frame_set(rms_frame_t *f, int ch, int v)
+{
+    int s = ch % 2 * 4;
+
+    f->hi[ch] = v >> 4;
+    f->lo[ch / 2] = (f->lo[ch / 2] & ~(0xf << s)) | ((v & 0xf) << s);
+}
+#endif
+
+/* Statistics of the last completed one-second window of each input */
+struct rms_window_stats
+{
+    int16_t min_mv;
+    int16_t max_mv;
+    uint16_t vpp_mv;
+    uint16_t rms_mv;
+    int16_t dc_mv;
+    uint16_t crest_x100; // peak / RMS
+};
 
 /* Functions */
-void add_v(int led, int val);
-void calculate_rms(void);
\ No newline at end of file
+void rms_add_frames(const rms_frame_t *frames, int n);
+void calculate_rms(void);
+void rms_set_calibration(int led, int32_t scale_q16, int32_t offset_mv);
+void rms_reset(void);
+int rms_window_len(int j);
+
+/* Engine state lives in rms.c, owned by the pipeline DSP stage (other threads use pipeline_results_get()) */
+int rms_fifo_head(void);                                      // FIFO position of the next frame to be written
+int rms_fifo_sample(int led, int pos);                        // stored sample of an input, pos taken modulo N_VOLTAGE
+uint16_t rms_window_mv(int i);                                // RMS of window i, windows of an input are consecutive
+void rms_window_sums(int i, int64_t *sum, uint64_t *sumsq);   // running sums behind window i
+const struct rms_window_stats *rms_last_window(int led);      // last completed one-second window
+
+#endif
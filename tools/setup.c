@@ -1,33 +1,33 @@
 #include "setup.h"
 #include "bt.h"
 #include "rms.h"
+#include "adc.h"
+#include "input.h"
+#include "state.h"
+#include "pipeline.h"
 
 /* Logger */
 LOG_MODULE_REGISTER(setup, LOG_LEVEL_INF);
 
-void check_devices_ready(struct gpio_dt_spec led, struct pwm_dt_spec pwm,
-                         struct adc_dt_spec adc0, struct adc_dt_spec adc1, struct adc_dt_spec adc2)
+void check_devices_ready(struct gpio_dt_spec led, const struct pwm_dt_spec *pwms,
+                         const struct adc_dt_spec *adcs, int n_inputs)
 {
     // Check gpio0 interface
     if (!device_is_ready(led.port))
         LOG_ERR("GPIO0 not ready.");
 
-    // Check ADC devices
-    if (!device_is_ready(adc0.dev))
-        LOG_ERR("ADC Channel 0 not ready.");
-    if (!device_is_ready(adc1.dev))
-        LOG_ERR("ADC Channel 1 not ready.");
-    if (!device_is_ready(adc2.dev))
-        LOG_ERR("ADC Channel 2 not ready.");
-
-    // Check PWM
-    if (!device_is_ready(pwm.dev))
-        LOG_ERR("PWM not ready.");
+    // Check ADC and PWM devices of each input
+    for (int ch = 0; ch < n_inputs; ch++)
+    {
+        if (!device_is_ready(adcs[ch].dev))
+            LOG_ERR("ADC Channel %d not ready.", adcs[ch].channel_id);
+        if (!device_is_ready(pwms[ch].dev))
+            LOG_ERR("PWM %d not ready.", ch);
+    }
 }
 
 void configure_pins(struct gpio_dt_spec led1, struct gpio_dt_spec led2, struct gpio_dt_spec led3,
-                    struct gpio_dt_spec btn1, struct gpio_dt_spec btn2,
-                    struct adc_dt_spec adc0, struct adc_dt_spec adc1, struct adc_dt_spec adc2)
+                    struct gpio_dt_spec btn1, struct gpio_dt_spec btn2)
 {
     int err;
     // Output LED pins
@@ -42,58 +42,48 @@ void configure_pins(struct gpio_dt_spec led1, struct gpio_dt_spec led2, struct g
     err += gpio_pin_configure_dt(&btn2, GPIO_INPUT);
     if (err)
         LOG_ERR("Error configuring input button pins.");
+}
 
-    // ADC input pin
-    err = adc_channel_setup_dt(&adc0);
-    if (err)
-        LOG_ERR("Error configuring ADC channel 0.");
-    err = adc_channel_setup_dt(&adc1);
-    if (err)
-        LOG_ERR("Error configuring ADC channel 1.");
-    err = adc_channel_setup_dt(&adc2);
+int configure_adc(const struct adc_dt_spec *adc)
+{
+    int err = adc_channel_setup_dt(adc);
+    if (!err)
+        err = adc_prepare(adc);
     if (err)
-        LOG_ERR("Error configuring ADC channel 2.");
+        LOG_ERR("Error configuring ADC channel %d.", adc->channel_id);
+    return err;
 }
 
 /* Callbacks */
-void on_save(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+void on_save(void)
 {
-    if (state == STATE_DEFAULT)
+    if (state_is_active())
     {
-        set_data(vble);
+        struct pipeline_results res;
+        pipeline_results_get(&res);
+        set_data(res.rms_mv, res.spectrum_mv);
     }
 }
 
-void on_bt_send(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+void on_bt_send(void)
 {
-    if (state == STATE_DEFAULT)
+    if (state_is_active())
     {
-        // send the two, 5-point data arrays to phone via Bluetooth
+        // send the two, 5-point data arrays (and spectrum, MTU permitting) to phone via Bluetooth
         LOG_INF("Sending arrays to phone via Bluetooth");
 
-        err = send_data_notification(current_conn, N_BLE*2);
-        if (err)
-            LOG_ERR("Could not send BT notification (err: %d)", err);
+        int sent = send_data_notification_all();
+        if (sent < 0)
+            LOG_ERR("Could not send BT notification (err: %d)", sent);
+        else if (sent == 0)
+            LOG_WRN("No connection subscribed to data notifications");
     }
 }
 
 void setup_callbacks(struct gpio_dt_spec btn1, struct gpio_dt_spec btn2)
 {
-    /* Define variables of type static struct gpio_callback */
-    static struct gpio_callback save_cb;
-    static struct gpio_callback bt_cb;
-
-    /* Configure interrupts on button pins */
-    err = gpio_pin_interrupt_configure_dt(&btn1, GPIO_INT_EDGE_TO_ACTIVE);
-    err += gpio_pin_interrupt_configure_dt(&btn2, GPIO_INT_EDGE_TO_ACTIVE);
-    if (err) LOG_ERR("Error configuring pin interrupts.");
-
-    /* Initialize gpio_callback variables */
-    gpio_init_callback(&save_cb, on_save, BIT(btn1.pin));
-    gpio_init_callback(&bt_cb, on_bt_send, BIT(btn2.pin));
-
-    /* Attach callback functions */
-    err = gpio_add_callback(btn1.port, &save_cb);
-    err += gpio_add_callback(btn2.port, &bt_cb);
-    if (err) LOG_ERR("Error attaching callback functions");
-}
\ No newline at end of file
+    /* Debounced in the input module; actions run in its work queue thread */
+    int err = input_add_button(&btn1, on_save);
+    err += input_add_button(&btn2, on_bt_send);
+    if (err) LOG_ERR("Error configuring button callbacks.");
+}
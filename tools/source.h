@@ -0,0 +1,24 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "macros.h"
+
+/*
+ * Where the signal path gets its frames from. The acquisition loop reads one
+ * frame (a raw count per input, in scan order) per call and hands it to the
+ * pipeline; everything after that (filters, RMS, events, outputs) is the
+ * same whichever source is in use. The SAADC (adc.c) is paced by the frame
+ * timer; a recording (replay.c) is read as fast as the pipeline takes it.
+ */
+struct frame_source
+{
+    const char *name;
+    int (*open)(void);
+    int (*read)(int16_t frame[N_INPUT]); // -ENODATA once a finite source is exhausted
+    void (*finish)(void);                // after -ENODATA, once the pipeline has drained
+    bool paced;                          // one frame per frame-timer tick
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/smf.h>
+#include <string.h>
+#if defined(CONFIG_HAS_NRFX)
+#include <nrfx_power.h>
+#endif
+#include "state.h"
+#include "cmd.h"
+#include "wave.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(state, LOG_LEVEL_INF);
+
+enum device_state
+{
+    DEV_ACQUIRE,
+    DEV_CHARGING,
+};
+
+static struct state_obj
+{
+    struct smf_ctx ctx; // must be first
+    bool vbus;
+} sm;
+
+static atomic_t current = ATOMIC_INIT(STATE_DEFAULT);
+static atomic_t vbus_present;
+
+/* Given on entry to ACQUIRE, for the sampling loop sleeping in state_wait_active() */
+static K_SEM_DEFINE(active_sem, 0, 1);
+
+/* Held while an LED output is written and while acquire_exit() turns them off */
+static K_MUTEX_DEFINE(output_lock);
+
+static const struct gpio_dt_spec *led_vbus;
+static struct pwm_dt_spec led_pwms[N_INPUT];
+
+static const struct smf_state dev_states[];
+
+/* VBUS LED */
+static void toggle_vbus_led(struct k_timer *timer)
+{
+    int err = gpio_pin_toggle_dt(led_vbus);
+    if (err)
+        LOG_ERR("Error toggling VBUS LED.");
+}
+
+static void set_vbus_led_off(struct k_timer *timer)
+{
+    int err = gpio_pin_set_dt(led_vbus, 0);
+    if (err)
+        LOG_ERR("Error turning off VBUS LED.");
+}
+K_TIMER_DEFINE(vbus_led_timer, toggle_vbus_led, set_vbus_led_off);
+
+/* ACQUIRE */
+static void acquire_entry(void *o)
+{
+    atomic_set(&current, STATE_DEFAULT);
+    k_sem_give(&active_sem);
+    cmd_stream_pause(false);
+    if (IS_ENABLED(CONFIG_WAVE))
+        wave_start();
+    LOG_INF("Acquisition running");
+}
+
+static void acquire_run(void *o)
+{
+    struct state_obj *s = o;
+
+    if (s->vbus)
+        smf_set_state(SMF_CTX(s), &dev_states[DEV_CHARGING]);
+}
+
+static void acquire_exit(void *o)
+{
+    // publish first so the sampling loop stops before the outputs go dark;
+    // under the lock, so no output write started before can land after
+    k_mutex_lock(&output_lock, K_FOREVER);
+    atomic_set(&current, STATE_VBUS_DETECTED);
+    for (int ch = 0; ch < N_INPUT; ch++)
+    {
+        int err = pwm_set_pulse_dt(&led_pwms[ch], 0);
+        if (err)
+            LOG_ERR("Error turning off LED %d.", ch + 1);
+    }
+    k_mutex_unlock(&output_lock);
+
+    cmd_stream_pause(true);
+    if (IS_ENABLED(CONFIG_WAVE))
+        wave_stop();
+}
+
+/* CHARGING */
+static void charging_entry(void *o)
+{
+    LOG_ERR("VBUS voltage detected. Device cannot be operated while charging.");
+    k_timer_start(&vbus_led_timer, K_MSEC(T_VBUS_LED), K_MSEC(T_VBUS_LED));
+}
+
+static void charging_run(void *o)
+{
+    struct state_obj *s = o;
+
+    if (!s->vbus)
+        smf_set_state(SMF_CTX(s), &dev_states[DEV_ACQUIRE]);
+}
+
+static void charging_exit(void *o)
+{
+    k_timer_stop(&vbus_led_timer);
+}
+
+static const struct smf_state dev_states[] = {
+    [DEV_ACQUIRE] = SMF_CREATE_STATE(acquire_entry, acquire_run, acquire_exit),
+    [DEV_CHARGING] = SMF_CREATE_STATE(charging_entry, charging_run, charging_exit),
+};
+
+static void state_work_handler(struct k_work *work)
+{
+    sm.vbus = atomic_get(&vbus_present);
+    smf_run_state(SMF_CTX(&sm));
+}
+static K_WORK_DEFINE(state_work, state_work_handler);
+
+/* USB supply present; boards without the nRF USB regulator (native_sim) never charge */
+static bool vbus_detected(void)
+{
+#if defined(CONFIG_HAS_NRFX)
+    return nrf_power_usbregstatus_vbusdet_get(NRF_POWER);
+#else
+    return false;
+#endif
+}
+
+/* Runs in ISR context: only sample VBUS and hand over to the work queue */
+static void check_vbus(struct k_timer *timer)
+{
+    bool vbus = vbus_detected();
+
+    if (atomic_set(&vbus_present, vbus) != vbus)
+        k_work_submit(&state_work);
+}
+K_TIMER_DEFINE(vbus_timer, check_vbus, NULL);
+
+int state_init(const struct gpio_dt_spec *vbus_led, const struct pwm_dt_spec *pwms)
+{
+    if (vbus_led == NULL || pwms == NULL)
+        return -EINVAL;
+
+    led_vbus = vbus_led;
+    memcpy(led_pwms, pwms, sizeof(led_pwms));
+
+    smf_set_initial(SMF_CTX(&sm), &dev_states[DEV_ACQUIRE]);
+    k_timer_start(&vbus_timer, K_NO_WAIT, K_MSEC(T_VBUS));
+    return 0;
+}
+
+int state_get(void)
+{
+    return atomic_get(&current);
+}
+
+bool state_is_active(void)
+{
+    return atomic_get(&current) == STATE_DEFAULT;
+}
+
+void state_wait_active(void)
+{
+    while (!state_is_active())
+        k_sem_take(&active_sem, K_FOREVER);
+}
+
+int state_set_output(const struct pwm_dt_spec *pwm, uint32_t pulse)
+{
+    int ret = 0;
+
+    k_mutex_lock(&output_lock, K_FOREVER);
+    if (state_is_active())
+        ret = pwm_set_pulse_dt(pwm, pulse);
+    k_mutex_unlock(&output_lock);
+    return ret;
+}
@@ -0,0 +1,29 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/pwm.h>
+#include <stdbool.h>
+#include "macros.h"
+
+/*
+ * Device state machine (SMF). VBUS is sampled from a timer; transitions and
+ * their entry/exit actions run in the system work queue. The current state
+ * is published atomically, so any context can read it without a lock.
+ *
+ *   ACQUIRE --VBUS detected--> CHARGING --VBUS removed--> ACQUIRE
+ *
+ * Leaving ACQUIRE stops acquisition, turns the LED outputs off and pauses
+ * streaming and the waveform; entering it resumes them. LED outputs are
+ * written through state_set_output(), serialised with that switch-off, so a
+ * block still in flight cannot relight an LED while charging.
+ */
+
+/* Functions */
+int state_init(const struct gpio_dt_spec *vbus_led, const struct pwm_dt_spec *pwms);
+int state_get(void); // STATE_DEFAULT or STATE_VBUS_DETECTED
+bool state_is_active(void);
+void state_wait_active(void); // blocks while charging
+int state_set_output(const struct pwm_dt_spec *pwm, uint32_t pulse); // ignored unless active
+
+#endif
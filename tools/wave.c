@@ -0,0 +1,216 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <nrfx_pwm.h>
+#include "wave.h"
+#include "lut.h"
+
+/* Logger */
+LOG_MODULE_REGISTER(wave, LOG_LEVEL_INF);
+
+/*
+ * The waveform is played by a PWM instance that is not used by the Zephyr
+ * PWM driver. Every table entry becomes one 16-bit compare value in RAM which
+ * EasyDMA fetches on its own; REFRESH stretches each entry over several PWM
+ * periods and the LOOP shortcut restarts the sequence, so the CPU is only
+ * involved when the table, frequency or amplitude change.
+ */
+static const nrfx_pwm_t wave_pwm = NRFX_PWM_INSTANCE(1);
+
+// bit 15 of a compare value selects the edge polarity of the output
+#define WAVE_POLARITY (IS_ENABLED(CONFIG_WAVE_OUT_INVERTED) ? 0 : BIT(15))
+#define WAVE_REFRESH_MAX 0xFFFFFF
+#define WAVE_CLK_COUNT 8
+
+static uint16_t ramp[CONFIG_WAVE_RAMP_STEPS];
+
+// the built-in tables must fit the sequence buffer, or wave_play() fails at runtime
+BUILD_ASSERT(LUT_SINE_STEPS <= CONFIG_WAVE_MAX_STEPS, "CONFIG_LUT_SINE_STEPS exceeds CONFIG_WAVE_MAX_STEPS");
+BUILD_ASSERT(CONFIG_WAVE_RAMP_STEPS <= CONFIG_WAVE_MAX_STEPS, "CONFIG_WAVE_RAMP_STEPS exceeds CONFIG_WAVE_MAX_STEPS");
+
+static nrf_pwm_values_common_t seq_values[CONFIG_WAVE_MAX_STEPS];
+static nrf_pwm_sequence_t seq = {
+    .values.p_common = seq_values,
+    .length = 0,
+    .repeats = 0,
+    .end_delay = 0,
+};
+
+static const uint16_t *table;
+static size_t table_len;
+static uint16_t amplitude = WAVE_FULL_SCALE;
+static uint32_t frequency = CONFIG_WAVE_DEFAULT_FREQ_MHZ;
+static nrf_pwm_clk_t base_clock = NRF_PWM_CLK_16MHz;
+static bool initialized;
+static bool playing;
+
+/* Convert the source table into compare values for the current amplitude */
+static void compile_table(void)
+{
+    for (size_t i = 0; i < table_len; i++)
+    {
+        uint32_t duty = (uint32_t)table[i] * amplitude / WAVE_FULL_SCALE;
+        seq_values[i] = (duty * CONFIG_WAVE_TOP / WAVE_FULL_SCALE) | WAVE_POLARITY;
+    }
+    seq.length = table_len;
+}
+
+/* Pick the fastest base clock whose REFRESH count still fits the register */
+static int compute_timing(uint32_t freq_mhz, size_t len, nrf_pwm_clk_t *clk, uint32_t *refresh)
+{
+    uint64_t step_mhz = (uint64_t)freq_mhz * len;
+
+    if (step_mhz == 0)
+        return -EINVAL;
+
+    for (int c = NRF_PWM_CLK_16MHz; c < WAVE_CLK_COUNT; c++)
+    {
+        uint64_t clk_hz = 16000000ULL >> c;
+        uint64_t periods = clk_hz * 1000 / (CONFIG_WAVE_TOP * step_mhz);
+
+        if (periods == 0)
+            return -EINVAL; // slower clocks only make it worse
+        if (periods - 1 <= WAVE_REFRESH_MAX)
+        {
+            *clk = (nrf_pwm_clk_t)c;
+            *refresh = periods - 1;
+            return 0;
+        }
+    }
+    return -ERANGE;
+}
+
+static int restart(void)
+{
+    nrf_pwm_clk_t clk;
+    uint32_t refresh;
+
+    int err = compute_timing(frequency, table_len, &clk, &refresh);
+    if (err)
+    {
+        LOG_ERR("Frequency %d mHz not reachable with %zu steps", frequency, table_len);
+        return err;
+    }
+
+    if (playing)
+        nrfx_pwm_stop(&wave_pwm, true);
+
+    base_clock = clk;
+    seq.repeats = refresh;
+    nrf_pwm_configure(wave_pwm.p_registers, base_clock, NRF_PWM_MODE_UP, CONFIG_WAVE_TOP);
+    compile_table();
+
+    (void)nrfx_pwm_simple_playback(&wave_pwm, &seq, 1, NRFX_PWM_FLAG_LOOP);
+    playing = true;
+    LOG_DBG("Playing %zu steps at %d mHz (clk=%d, refresh=%d)", table_len, frequency, clk, refresh);
+    return 0;
+}
+
+int wave_init(void)
+{
+    nrfx_pwm_config_t config = NRFX_PWM_DEFAULT_CONFIG(CONFIG_WAVE_OUT_PIN,
+                                                       NRFX_PWM_PIN_NOT_USED,
+                                                       NRFX_PWM_PIN_NOT_USED,
+                                                       NRFX_PWM_PIN_NOT_USED);
+    config.base_clock = base_clock;
+    config.count_mode = NRF_PWM_MODE_UP;
+    config.top_value = CONFIG_WAVE_TOP;
+    config.load_mode = NRF_PWM_LOAD_COMMON;
+    config.step_mode = NRF_PWM_STEP_AUTO;
+
+    // no event handler: playback loops in hardware without interrupts
+    nrfx_err_t ret = nrfx_pwm_init(&wave_pwm, &config, NULL, NULL);
+    if (ret != NRFX_SUCCESS)
+    {
+        LOG_ERR("nrfx_pwm_init returned 0x%08x", ret);
+        return -EIO;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(ramp); i++)
+    {
+        ramp[i] = i * WAVE_FULL_SCALE / (ARRAY_SIZE(ramp) - 1);
+    }
+
+    initialized = true;
+    return 0;
+}
+
+int wave_load(const uint16_t *table_in, size_t len)
+{
+    if (!initialized)
+        return -ENODEV;
+    if (table_in == NULL || len < 2 || len > CONFIG_WAVE_MAX_STEPS)
+        return -EINVAL;
+
+    table = table_in;
+    table_len = len;
+    return playing ? restart() : 0;
+}
+
+int wave_play(enum wave_shape shape)
+{
+    int err;
+
+    switch (shape)
+    {
+    case WAVE_SINE:
+        err = wave_load(lut_sine, LUT_SINE_STEPS);
+        break;
+    case WAVE_RAMP:
+        err = wave_load(ramp, ARRAY_SIZE(ramp));
+        break;
+    default:
+        return -EINVAL;
+    }
+    if (err)
+        return err;
+
+    return playing ? 0 : wave_start();
+}
+
+int wave_set_frequency(uint32_t freq_mhz)
+{
+    uint32_t prev = frequency;
+
+    frequency = freq_mhz;
+    if (!playing)
+        return 0;
+
+    int err = restart();
+    if (err)
+    {
+        frequency = prev;
+        (void)restart();
+    }
+    return err;
+}
+
+int wave_set_amplitude(uint16_t amplitude_in)
+{
+    if (amplitude_in > WAVE_FULL_SCALE)
+        return -EINVAL;
+
+    amplitude = amplitude_in;
+    // the sequence is re-read from RAM every step, so rewriting it in place is enough
+    if (table_len)
+        compile_table();
+    return 0;
+}
+
+int wave_start(void)
+{
+    if (!initialized)
+        return -ENODEV;
+    if (table_len == 0)
+        return -EINVAL;
+
+    return restart();
+}
+
+void wave_stop(void)
+{
+    if (!playing)
+        return;
+
+    nrfx_pwm_stop(&wave_pwm, true);
+    playing = false;
+}
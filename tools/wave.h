@@ -0,0 +1,26 @@
+#ifndef WAVE_H
+#define WAVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lut_tables.h"
+
+/* Table entries and amplitude are expressed in 0.01 % of full scale */
+#define WAVE_FULL_SCALE LUT_FULL_SCALE
+
+enum wave_shape
+{
+    WAVE_SINE,
+    WAVE_RAMP,
+};
+
+/* Functions */
+int wave_init(void);
+int wave_load(const uint16_t *table, size_t len);
+int wave_play(enum wave_shape shape);
+int wave_set_frequency(uint32_t freq_mhz);
+int wave_set_amplitude(uint16_t amplitude);
+int wave_start(void);
+void wave_stop(void);
+
+#endif